@@ -0,0 +1,63 @@
+#ifndef ARENA
+#define ARENA
+#include <iostream>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+using ll = long long;
+
+// monotonic allocation for data that lives exactly as long as one complex build
+// memory is carved out of large blocks, nothing is freed on its own, and every
+// block goes back in one shot when the arena is destroyed. only trivially
+// destructible types should be put in here since no destructors are run
+
+class ArenaStats{
+    public:
+        ll allocations = 0; // calls to allocate
+        ll bytesUsed = 0; // bytes handed out, alignment padding included
+        ll bytesReserved = 0; // bytes in all blocks
+        ll blocks = 0;
+};
+
+ostream& operator<<(ostream &out, const ArenaStats &stats){
+    return out << stats.allocations << " allocations, " << stats.bytesUsed << " bytes used of "
+    << stats.bytesReserved << " reserved in " << stats.blocks << " blocks";
+}
+
+class Arena{
+    private:
+        vector<char*> blocks;
+        size_t blockSize;
+        size_t offset = 0, capacity = 0; // within the last block
+        ArenaStats counters;
+    public:
+        Arena(size_t defaultBlockSize = 1 << 20) : blockSize(defaultBlockSize) {}
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        ~Arena(){
+            for (char *block : blocks) delete[] block;
+        }
+        template<class T> T* allocate(size_t count){
+            // uninitialised room for count objects of type T
+            size_t bytes = count * sizeof(T), align = alignof(T);
+            size_t start = (offset + align - 1) / align * align;
+            if (blocks.empty() || start + bytes > capacity){
+                // a request larger than blockSize gets a block of its own size
+                capacity = max(blockSize, bytes);
+                blocks.push_back(new char[capacity]); // aligned for any fundamental type
+                counters.blocks++;
+                counters.bytesReserved += capacity;
+                offset = start = 0;
+            }
+            counters.allocations++;
+            counters.bytesUsed += start + bytes - offset;
+            offset = start + bytes;
+            return reinterpret_cast<T*>(blocks.back() + start);
+        }
+        const ArenaStats& stats() const{
+            return counters;
+        }
+};
+
+#endif
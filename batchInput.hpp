@@ -0,0 +1,131 @@
+#ifndef BATCH_INPUT
+#define BATCH_INPUT
+#include <iostream>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <algorithm>
+#include "mappedFile.hpp"
+
+using namespace std;
+
+// many diagrams in one file, one per line, so a whole knot table can go
+// through a single process:
+//
+//     3_1 1 5 2 4 3 1 4 6 5 3 6 2
+//     3_1a 1 5 2 4 3 1 4 6 5 3 6 2 ; 5 3 1 ; 2 5 ; 4 6 2 ; 1 4 ; 3 6 ; @ 0
+//
+// a line is an id, then the planar diagram as 4 integers per crossing. annular
+// diagrams go on with the faces, each one its list of mini-strands after a
+// ';', the punctured face first, and may end with '@ r' to restrict to
+// annular grading r. blank lines and lines starting with '#' are skipped
+
+class BatchDiagram{
+    public:
+        string id;
+        int line = 0; // in the batch file, for error messages
+        vector<vector<int>> crossings;
+        vector<vector<int>> faces; // empty for a non-annular diagram
+        bool restrictAnnularGrading = 0;
+        int annularGrading = 0;
+};
+
+bool isBatchSpace(char c){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool parseDiagramLine(const char *p, const char *lineEnd, BatchDiagram &diagram, string &error){
+    // one non-blank line of a batch file; on failure error says why
+    diagram = BatchDiagram();
+    while (p < lineEnd && isBatchSpace(*p)) p++;
+    const char *idEnd = p;
+    while (idEnd < lineEnd && !isBatchSpace(*idEnd)) idEnd++;
+    diagram.id.assign(p, idEnd);
+    p = idEnd;
+
+    vector<int> *numbers = nullptr; // where the next integer goes
+    vector<int> strands;
+    bool seenGrading = 0;
+    auto fail = [&](const string &why){
+        error = why;
+        return 0;
+    };
+    while (true){
+        while (p < lineEnd && isBatchSpace(*p)) p++;
+        if (p == lineEnd) break;
+        if (*p == ';'){
+            if (seenGrading) return fail("faces after the annular grading");
+            diagram.faces.emplace_back();
+            numbers = &diagram.faces.back();
+            p++;
+        }
+        else if (*p == '@'){
+            if (seenGrading) return fail("two annular gradings");
+            if (!diagram.faces.empty() && diagram.faces.back().empty()) diagram.faces.pop_back(); // "; @ r"
+            if (diagram.faces.empty()) return fail("annular grading without faces");
+            seenGrading = 1;
+            numbers = nullptr;
+            p++;
+            while (p < lineEnd && isBatchSpace(*p)) p++;
+            auto [next, parseError] = from_chars(p, lineEnd, diagram.annularGrading);
+            if (parseError != errc()) return fail("expected an annular grading after '@'");
+            diagram.restrictAnnularGrading = 1;
+            p = next;
+        }
+        else{
+            if (seenGrading) return fail("unexpected text after the annular grading");
+            int x;
+            auto [next, parseError] = from_chars(p, lineEnd, x);
+            if (parseError != errc()) return fail("expected an integer, got '" + string(p, find_if(p, lineEnd, isBatchSpace)) + "'");
+            if (numbers) numbers->push_back(x);
+            else strands.push_back(x);
+            p = next;
+        }
+    }
+    if (strands.empty()) return fail("diagram " + diagram.id + " has no crossings");
+    if (strands.size() % 4) return fail("diagram " + diagram.id + " has " + to_string(strands.size()) + " strand labels, not a multiple of 4");
+    for (size_t i = 0; i < strands.size(); i += 4){
+        diagram.crossings.push_back(vector<int>(strands.begin() + i, strands.begin() + i + 4));
+    }
+    for (auto &face : diagram.faces){
+        if (face.empty()) return fail("empty face in diagram " + diagram.id);
+    }
+    return 1;
+}
+
+class DiagramBatch{
+    // hands out the diagrams of a batch file in order, parsed in place from
+    // the mapped file
+    private:
+        string path;
+        MappedFile file;
+        const char *position, *end;
+        int lineNumber = 0;
+    public:
+        DiagramBatch(const string &filePath) : path(filePath), file(filePath){
+            position = file.data();
+            end = file.data() + file.size();
+        }
+        bool next(BatchDiagram &diagram){
+            // false once the file is exhausted
+            while (position < end){
+                const char *lineEnd = position;
+                while (lineEnd < end && *lineEnd != '\n') lineEnd++;
+                const char *p = position;
+                position = lineEnd < end ? lineEnd + 1 : end;
+                lineNumber++;
+                while (p < lineEnd && isBatchSpace(*p)) p++;
+                if (p == lineEnd || *p == '#') continue;
+                string error;
+                if (!parseDiagramLine(p, lineEnd, diagram, error)){
+                    cerr << path << ":" << lineNumber << ": " << error << endl;
+                    exit(1);
+                }
+                diagram.line = lineNumber;
+                return 1;
+            }
+            return 0;
+        }
+};
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef BINARY_MAPS
+#define BINARY_MAPS
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "matrices.hpp"
+#include "mappedFile.hpp"
+
+using namespace std;
+
+using ll = long long;
+using ull = unsigned long long;
+
+// binary container for a whole chain complex, written in one buffered pass
+// and read back through mmap. every field is a little-endian 8-byte integer:
+//
+//     file header:  magic "KHMAPS01", version, crossings, reduced,
+//                   annularGrading, numMaps
+//     directory:    per map: degree, domain, codomain, encoding, offset, entries
+//     data:         each map at its offset
+//
+// reduced is 1 for reduced and 0 for unreduced homology, annularGrading is
+// noAnnularGrading unless the complex is an annular subcomplex. a map goes
+// from the domain generators of homological degree `degree` to the codomain
+// generators of degree + 1, as columns, with one of two encodings:
+//     denseColumns:  domain columns of (codomain + 63) / 64 words each, bit r
+//                    of column j set when generator j maps onto generator r
+//     sparseColumns: domain + 1 column starts into the row list, then the
+//                    entries rows, increasing within each column
+// the writer picks whichever is smaller for every map, and the reader checks
+// that every map lies inside the file and indexes only rows it has.
+// there are no per-generator gradings: a generator's homological degree is
+// its map's degree, and the builders' basis is not homogeneous in q (see
+// differentialImages), so there is no quantum grading to record
+
+const ull binaryMapsMagic = 0x31305350414d484bull; // "KHMAPS01"
+const ll binaryMapsVersion = 1;
+const ll noAnnularGrading = LLONG_MIN;
+enum MapEncoding{denseColumns = 0, sparseColumns = 1};
+
+class BinaryMapsHeader{
+    public:
+        ull magic = binaryMapsMagic;
+        ll version = binaryMapsVersion;
+        ll crossings = 0;
+        ll reduced = 0;
+        ll annularGrading = noAnnularGrading;
+        ll numMaps = 0;
+};
+
+class BinaryMapEntry{
+    public:
+        ll degree = 0;
+        ll domain = 0, codomain = 0;
+        ll encoding = denseColumns;
+        ll offset = 0; // bytes from the start of the file
+        ll entries = 0; // nonzero entries
+};
+
+void writeBinaryMaps(FILE *file, vector<Matrix> &maps, ll crossings, bool reduced, ll annularGrading = noAnnularGrading){
+    // maps[i] is d_i stored as a vector of column vectors, as the builders return it
+    BinaryMapsHeader header;
+    header.crossings = crossings;
+    header.reduced = reduced;
+    header.annularGrading = annularGrading;
+    header.numMaps = maps.size();
+    vector<BinaryMapEntry> directory(maps.size());
+    ll offset = sizeof(header) + sizeof(BinaryMapEntry) * maps.size();
+    for (ll i = 0; i < (ll)maps.size(); i++){
+        BinaryMapEntry &entry = directory[i];
+        entry.degree = i;
+        entry.domain = maps[i].r;
+        entry.codomain = maps[i].c;
+        for (auto &column : maps[i].mat) entry.entries += count(column.begin(), column.end(), true);
+        ll denseWords = entry.domain * ((entry.codomain + 63) / 64);
+        ll sparseWords = entry.domain + 1 + entry.entries;
+        entry.encoding = sparseWords < denseWords ? sparseColumns : denseColumns;
+        entry.offset = offset;
+        offset += 8 * min(denseWords, sparseWords);
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(directory.data(), sizeof(BinaryMapEntry), directory.size(), file);
+
+    vector<ull> words;
+    for (ll i = 0; i < (ll)maps.size(); i++){
+        BinaryMapEntry &entry = directory[i];
+        if (entry.encoding == denseColumns){
+            words.assign((entry.codomain + 63) / 64, 0);
+            for (auto &column : maps[i].mat){
+                fill(words.begin(), words.end(), 0);
+                for (ll r = 0; r < entry.codomain; r++){
+                    if (column[r]) words[r >> 6] |= (1ull << (r & 63));
+                }
+                fwrite(words.data(), sizeof(ull), words.size(), file);
+            }
+        }
+        else{
+            ll start = 0;
+            for (auto &column : maps[i].mat){
+                fwrite(&start, sizeof(ll), 1, file);
+                start += count(column.begin(), column.end(), true);
+            }
+            fwrite(&start, sizeof(ll), 1, file);
+            for (auto &column : maps[i].mat){
+                for (ll r = 0; r < entry.codomain; r++){
+                    if (column[r]) fwrite(&r, sizeof(ll), 1, file);
+                }
+            }
+        }
+    }
+}
+
+void writeBinaryMaps(const string &path, vector<Matrix> &maps, ll crossings, bool reduced, ll annularGrading = noAnnularGrading){
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file){
+        cerr << "Could not open " << path << " for writing." << endl;
+        exit(1);
+    }
+    vector<char> buffer(1 << 22);
+    setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+    writeBinaryMaps(file, maps, crossings, reduced, annularGrading);
+    fclose(file);
+}
+
+string binaryMapsBytes(vector<Matrix> &maps, ll crossings, bool reduced, ll annularGrading = noAnnularGrading){
+    // the contents of the file writeBinaryMaps would write, for sending elsewhere
+    FILE *file = tmpfile();
+    if (!file){
+        cerr << "Could not create a temporary file." << endl;
+        exit(1);
+    }
+    writeBinaryMaps(file, maps, crossings, reduced, annularGrading);
+    string ret(ftell(file), '\0');
+    rewind(file);
+    if (fread(&ret[0], 1, ret.size(), file) != ret.size()) ret.clear();
+    fclose(file);
+    return ret;
+}
+
+class BinaryMap{
+    // one map inside a BinaryMapsFile; a view into the file's memory
+    public:
+        BinaryMapEntry entry;
+        const ull *data = nullptr;
+        ll columnWords() const{ // words per column for denseColumns
+            return (entry.codomain + 63) / 64;
+        }
+        template<class F> void forEachColumn(F f) const{
+            // f(column, rows, count) for every column in order, rows increasing
+            if (entry.encoding == sparseColumns){
+                const ll *starts = reinterpret_cast<const ll*>(data);
+                const ll *rows = starts + entry.domain + 1;
+                for (ll j = 0; j < entry.domain; j++) f(j, rows + starts[j], starts[j+1] - starts[j]);
+                return;
+            }
+            vector<ll> rows;
+            for (ll j = 0; j < entry.domain; j++){
+                rows.clear();
+                const ull *column = data + j * columnWords();
+                for (ll w = 0; w < columnWords(); w++){
+                    for (ull bits = column[w]; bits; bits &= bits - 1) rows.push_back(w * 64 + __builtin_ctzll(bits));
+                }
+                f(j, (const ll*)rows.data(), (ll)rows.size());
+            }
+        }
+        Matrix toMatrix() const{
+            Matrix ret(entry.domain, entry.codomain);
+            forEachColumn([&](ll column, const ll *rows, ll count){
+                for (ll k = 0; k < count; k++) ret[column][rows[k]] = 1;
+            });
+            return ret;
+        }
+};
+
+class BinaryMapsFile{
+    // a file written by writeBinaryMaps, see MappedFile
+    private:
+        string path;
+        MappedFile file;
+        BinaryMapsHeader header;
+        vector<BinaryMapEntry> directory;
+        void fail(const string &why){
+            cerr << path << ": " << why << endl;
+            exit(1);
+        }
+        void check(int k, size_t fileSize){
+            // map k must fit in the file with no rows at or past codomain, a
+            // dense map must hold as many entries as the directory says, and
+            // a sparse one must have column starts running from 0 to entries
+            // and increasing rows in every column, so forEachColumn never
+            // reads outside
+            const BinaryMapEntry &entry = directory[k];
+            string where = "map " + to_string(k) + ": ";
+            if (entry.domain < 0 || entry.codomain < 0 || entry.entries < 0) fail(where + "negative size");
+            if (entry.encoding != denseColumns && entry.encoding != sparseColumns) fail(where + "unknown encoding " + to_string(entry.encoding));
+            if (entry.offset < 0 || entry.offset % 8 || (size_t)entry.offset > fileSize) fail(where + "bad offset");
+            ll available = (fileSize - entry.offset) / 8; // words from the offset to the end of the file
+            BinaryMap view = map(k);
+            if (entry.encoding == denseColumns){
+                ll columnWords = view.columnWords();
+                if (columnWords && entry.domain > available / columnWords) fail(where + "truncated map data");
+                ull padding = entry.codomain % 64 ? ~0ull << (entry.codomain % 64) : 0; // bits past the last row
+                ll entries = 0;
+                for (ll j = 0; j < entry.domain; j++){
+                    const ull *column = view.data + j * columnWords;
+                    if (padding && (column[columnWords - 1] & padding)) fail(where + "row out of range in column " + to_string(j));
+                    for (ll w = 0; w < columnWords; w++) entries += __builtin_popcountll(column[w]);
+                }
+                if (entries != entry.entries) fail(where + "has " + to_string(entries) + " entries, the directory says " + to_string(entry.entries));
+                return;
+            }
+            if (entry.domain >= available || entry.entries > available - entry.domain - 1) fail(where + "truncated map data");
+            const ll *starts = reinterpret_cast<const ll*>(view.data);
+            const ll *rows = starts + entry.domain + 1;
+            if (starts[0] != 0 || starts[entry.domain] != entry.entries) fail(where + "column starts do not run from 0 to the entries");
+            for (ll j = 0; j < entry.domain; j++){
+                if (starts[j+1] < starts[j] || starts[j+1] > entry.entries) fail(where + "bad column start " + to_string(j + 1));
+                for (ll e = starts[j]; e < starts[j+1]; e++){
+                    if (rows[e] < 0 || rows[e] >= entry.codomain) fail(where + "row out of range in column " + to_string(j));
+                    if (e > starts[j] && rows[e] <= rows[e-1]) fail(where + "rows not increasing in column " + to_string(j));
+                }
+            }
+        }
+    public:
+        explicit BinaryMapsFile(const string &filePath) : path(filePath), file(filePath){
+            const char *base = file.data();
+            size_t fileSize = file.size();
+            if (fileSize < sizeof(header)) fail("too short for a header");
+            memcpy(&header, base, sizeof(header));
+            if (header.magic != binaryMapsMagic) fail("not a binary maps file");
+            if (header.version != binaryMapsVersion) fail("unsupported version " + to_string(header.version));
+            if (header.numMaps < 0 || (size_t)header.numMaps > (fileSize - sizeof(header)) / sizeof(BinaryMapEntry)) fail("truncated directory");
+            directory.resize(header.numMaps);
+            memcpy(directory.data(), base + sizeof(header), header.numMaps * sizeof(BinaryMapEntry));
+            for (int k = 0; k < size(); k++) check(k, fileSize);
+        }
+        BinaryMapsFile(const BinaryMapsFile&) = delete;
+        BinaryMapsFile& operator=(const BinaryMapsFile&) = delete;
+        const BinaryMapsHeader& info() const{
+            return header;
+        }
+        int size() const{
+            return directory.size();
+        }
+        BinaryMap map(int k) const{
+            BinaryMap ret;
+            ret.entry = directory[k];
+            ret.data = reinterpret_cast<const ull*>(file.data() + directory[k].offset);
+            return ret;
+        }
+        vector<Matrix> matrices() const{
+            vector<Matrix> ret;
+            for (int k = 0; k < size(); k++) ret.push_back(map(k).toMatrix());
+            return ret;
+        }
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef BIT_VECTORS
+#define BIT_VECTORS
+#include <vector>
+using namespace std;
+
+using ull = unsigned long long;
+
+// packed bit vectors whose width is chosen at runtime
+// PackedBits<W> for W > 0 stores exactly W 64-bit words, so every operation
+// unrolls over the words actually needed; PackedBits<0> is the fallback for
+// anything wider and takes its word count from dynamicWords, which should be
+// set once per complex before any PackedBits<0> is created
+
+int dynamicWords = 1;
+
+template<int W> struct BitStorage{
+    ull w[W];
+    BitStorage(){
+        for (int i = 0; i < W; i++) w[i] = 0;
+    }
+    int words() const{
+        return W;
+    }
+};
+
+template<> struct BitStorage<0>{
+    vector<ull> w;
+    BitStorage() : w(dynamicWords, 0) {}
+    int words() const{
+        return w.size();
+    }
+};
+
+template<int W> class PackedBits{
+    private:
+        BitStorage<W> s;
+    public:
+        int size() const{ // number of bit positions available
+            return s.words() * 64;
+        }
+        int words() const{
+            return s.words();
+        }
+        ull word(int i) const{
+            return s.w[i];
+        }
+        ull& word(int i){
+            return s.w[i];
+        }
+        bool operator[](int i) const{
+            return (s.w[i >> 6] >> (i & 63)) & 1;
+        }
+        void set(int i){
+            s.w[i >> 6] |= (1ull << (i & 63));
+        }
+        void reset(int i){
+            s.w[i >> 6] &= ~(1ull << (i & 63));
+        }
+        void flip(int i){
+            s.w[i >> 6] ^= (1ull << (i & 63));
+        }
+        PackedBits& operator^=(const PackedBits &o){
+            for (int i = 0; i < s.words(); i++) s.w[i] ^= o.s.w[i];
+            return *this;
+        }
+        PackedBits& operator&=(const PackedBits &o){
+            for (int i = 0; i < s.words(); i++) s.w[i] &= o.s.w[i];
+            return *this;
+        }
+        PackedBits operator^(const PackedBits &o) const{
+            PackedBits ret = *this;
+            ret ^= o;
+            return ret;
+        }
+        bool operator==(const PackedBits &o) const{
+            for (int i = 0; i < s.words(); i++) if (s.w[i] != o.s.w[i]) return 0;
+            return 1;
+        }
+        bool operator!=(const PackedBits &o) const{
+            return !(*this == o);
+        }
+        bool none() const{
+            for (int i = 0; i < s.words(); i++) if (s.w[i]) return 0;
+            return 1;
+        }
+        int count() const{
+            int ret = 0;
+            for (int i = 0; i < s.words(); i++) ret += __builtin_popcountll(s.w[i]);
+            return ret;
+        }
+        int findNext(int i) const{ // first set bit strictly after i, size() if there is none
+            i++;
+            int wordIndex = i >> 6;
+            if (wordIndex >= s.words()) return size();
+            ull cur = s.w[wordIndex] & (~0ull << (i & 63));
+            while (!cur){
+                if (++wordIndex == s.words()) return size();
+                cur = s.w[wordIndex];
+            }
+            return (wordIndex << 6) + __builtin_ctzll(cur);
+        }
+        int findFirst() const{
+            return findNext(-1);
+        }
+        int findNextZero(int i) const{ // first unset bit at or after i, size() if there is none
+            int wordIndex = i >> 6;
+            if (wordIndex >= s.words()) return size();
+            ull cur = ~s.w[wordIndex] & (~0ull << (i & 63));
+            while (!cur){
+                if (++wordIndex == s.words()) return size();
+                cur = ~s.w[wordIndex];
+            }
+            return (wordIndex << 6) + __builtin_ctzll(cur);
+        }
+        void setPrefix(int len){ // sets bits [0, len)
+            for (int i = 0; i < s.words() && len > 0; i++, len -= 64){
+                s.w[i] |= (len >= 64 ? ~0ull : ((1ull << len) - 1));
+            }
+        }
+        void resetPrefix(int len){ // clears bits [0, len)
+            for (int i = 0; i < s.words() && len > 0; i++, len -= 64){
+                s.w[i] &= (len >= 64 ? 0ull : ~((1ull << len) - 1));
+            }
+        }
+};
+
+template<int W> PackedBits<W> nextPerm(const PackedBits<W> &v){
+    // next subset with the same number of bits in colexicographic order,
+    // returns the empty vector once the top bit would overflow
+    PackedBits<W> ret = v;
+    int lowest = v.findFirst();
+    if (lowest == v.size()) return ret;
+    int firstZero = v.findNextZero(lowest);
+    if (firstZero == v.size()) return PackedBits<W>();
+    ret.resetPrefix(firstZero);
+    ret.set(firstZero);
+    ret.setPrefix(firstZero - lowest - 1);
+    return ret;
+}
+
+int packedWordCount(long long bits){
+    // smallest fast-path word count that holds the given number of bits,
+    // 0 if the dynamic fallback is needed
+    long long words = (bits + 63) / 64;
+    for (int w : {1, 2, 4, 8, 16}){
+        if (words <= w) return w;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef CANONICAL_PD
+#define CANONICAL_PD
+#include <vector>
+#include <map>
+#include <queue>
+#include <algorithm>
+#include "differentialMaps.hpp"
+
+using namespace std;
+
+// a canonical relabelling of planar diagrams. renaming strands, reordering
+// crossings and rotating a crossing by two places (which keeps both of its
+// resolutions) give the same canonical diagram, so anything computed for it
+// holds for all of these up to a permutation of the generators. the
+// canonical diagram is the smallest crossing list, read as one sequence of
+// labels, over a breadth-first walk from every start: a start is a crossing
+// and a rotation, and the walk labels strands 1, 2, ... in the order it meets
+// them, giving each later crossing whichever rotation reads smaller.
+// with keepMarkedStrand the strand with the smallest label, where the reduced
+// complex puts its marked point, is labelled 1 before the walk starts. a
+// split diagram is walked one component after another in input order, so
+// relabellings of those may not always be recognised as equal
+
+class CanonicalPD{
+    public:
+        PD D;
+        map<int, int> label; // label[strand in the input] = strand in D
+};
+
+CanonicalPD canonicalPD(PD D, bool keepMarkedStrand){
+    int n = D.size();
+    map<int, vector<int>> crossingsOf; // strand -> crossings it meets
+    for (int i = 0; i < n; i++){
+        for (int x : D.crossings[i]) crossingsOf[x].push_back(i);
+    }
+    int marked = crossingsOf.empty() ? 0 : crossingsOf.begin()->first;
+
+    auto rotated = [&](int c, int rotation){
+        vector<int> ret(4);
+        for (int j = 0; j < 4; j++) ret[j] = D.crossings[c][(j + rotation) % 4];
+        return ret;
+    };
+    auto provisional = [&](const vector<int> &tuple, const map<int, int> &label){
+        // the labels this tuple would get if it came next
+        vector<int> ret;
+        map<int, int> fresh;
+        int next = label.size() + 1;
+        for (int x : tuple){
+            auto it = label.find(x);
+            if (it != label.end()) ret.push_back(it->second);
+            else{
+                if (!fresh.count(x)) fresh[x] = next++;
+                ret.push_back(fresh[x]);
+            }
+        }
+        return ret;
+    };
+    auto bestRotation = [&](int c, const map<int, int> &label){
+        return provisional(rotated(c, 2), label) < provisional(rotated(c, 0), label) ? 2 : 0;
+    };
+    auto walk = [&](int start, int startRotation, vector<int> &encoding, map<int, int> &label){
+        label.clear();
+        encoding.clear();
+        if (keepMarkedStrand) label[marked] = 1;
+        vector<bool> visited(n, 0);
+        for (int first = start; first != -1; ){
+            queue<int> q;
+            q.push(first);
+            visited[first] = 1;
+            while (!q.empty()){
+                int c = q.front();
+                q.pop();
+                int rotation = c == start ? startRotation : bestRotation(c, label);
+                vector<int> tuple = rotated(c, rotation);
+                for (int x : tuple){
+                    if (!label.count(x)){
+                        int next = label.size() + 1;
+                        label[x] = next;
+                    }
+                    encoding.push_back(label[x]);
+                }
+                for (int x : tuple){
+                    for (int other : crossingsOf[x]){
+                        if (!visited[other]){
+                            visited[other] = 1;
+                            q.push(other);
+                        }
+                    }
+                }
+            }
+            first = find(visited.begin(), visited.end(), 0) - visited.begin();
+            if (first == n) first = -1;
+        }
+    };
+
+    CanonicalPD ret;
+    vector<int> best, encoding;
+    map<int, int> label;
+    for (int start = 0; start < n; start++){
+        if (keepMarkedStrand && !count(D.crossings[start].begin(), D.crossings[start].end(), marked)) continue;
+        for (int rotation = 0; rotation < 4; rotation += 2){
+            walk(start, rotation, encoding, label);
+            if (best.empty() || encoding < best){
+                best = encoding;
+                ret.label = label;
+            }
+        }
+    }
+    ret.D = PD(n);
+    for (int i = 0; i < n; i++){
+        for (int j = 0; j < 4; j++) ret.D.crossings[i][j] = best[4*i + j];
+    }
+    return ret;
+}
+
+#endif
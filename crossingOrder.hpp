@@ -0,0 +1,110 @@
+#ifndef CROSSING_ORDER
+#define CROSSING_ORDER
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include "differentialMaps.hpp"
+
+using namespace std;
+
+// orders in which to take the crossings of a diagram so that every prefix
+// leaves few loose strand ends, a path decomposition of the strand graph of
+// small width. the tangle engine keeps a complex on exactly those ends, so its
+// intermediate complexes grow with the width of the order rather than with
+// the number of crossings. the order only changes the bookkeeping: homology by
+// degree does not depend on it, so results need no translating back, and
+// permuteCrossings keeps the user's strand labels
+
+class OrderWidth{
+    public:
+        int maximum = 0; // most loose ends after any prefix
+        ll total = 0; // summed over all prefixes
+        bool operator<(const OrderWidth &other) const{
+            return make_pair(maximum, total) < make_pair(other.maximum, other.total);
+        }
+};
+
+OrderWidth orderWidth(PD D, const vector<int> &order){
+    map<int, int> ends; // strand -> its ends among the crossings taken so far
+    int width = 0;
+    OrderWidth ret;
+    for (int i : order){
+        for (int x : D.crossings[i]){
+            int &e = ends[x];
+            e++;
+            width += e == 1 ? 1 : -1;
+        }
+        ret.maximum = max(ret.maximum, width);
+        ret.total += width;
+    }
+    return ret;
+}
+
+vector<int> greedyOrder(PD D, int start){
+    // from start, each time the crossing that leaves the fewest loose ends
+    int n = D.size();
+    vector<int> order = {start};
+    vector<bool> taken(n, 0);
+    taken[start] = 1;
+    map<int, int> ends, lastTouched; // strand -> step that last met it
+    for (int x : D.crossings[start]) ends[x]++, lastTouched[x] = 0;
+    for (int step = 1; step < n; step++){
+        // ties go to a crossing next to the latest ones, so the tangle grows
+        // from one end rather than in several places
+        int best = -1, bestChange = 5, bestRecent = -1;
+        for (int i = 0; i < n; i++){
+            if (taken[i]) continue;
+            int change = 0, recent = -1;
+            map<int, int> seen;
+            for (int x : D.crossings[i]){
+                auto it = ends.find(x);
+                int e = (it == ends.end() ? 0 : it->second) + seen[x]++;
+                change += e == 0 ? 1 : -1;
+                if (e) recent = max(recent, lastTouched[x]);
+            }
+            if (change < bestChange || (change == bestChange && recent > bestRecent)) best = i, bestChange = change, bestRecent = recent;
+        }
+        taken[best] = 1;
+        order.push_back(best);
+        for (int x : D.crossings[best]) ends[x]++, lastTouched[x] = step;
+    }
+    return order;
+}
+
+vector<int> minimumWidthOrder(PD D){
+    // the best greedy order over all starts, then improved by swapping
+    // neighbouring crossings for as long as that lowers the width
+    int n = D.size();
+    if (n == 0) return {};
+    vector<int> best;
+    OrderWidth bestWidth;
+    for (int start = 0; start < n; start++){
+        vector<int> order = greedyOrder(D, start);
+        OrderWidth width = orderWidth(D, order);
+        if (best.empty() || width < bestWidth) best = order, bestWidth = width;
+    }
+    bool improved = 1;
+    while (improved){
+        improved = 0;
+        for (int i = 0; i + 1 < n; i++){
+            swap(best[i], best[i+1]);
+            OrderWidth width = orderWidth(D, best);
+            if (width < bestWidth){
+                bestWidth = width;
+                improved = 1;
+            }
+            else swap(best[i], best[i+1]);
+        }
+    }
+    return best;
+}
+
+PD permuteCrossings(PD D, const vector<int> &order){
+    // crossing i of the result is crossing order[i] of D, strand labels unchanged
+    PD ret(order.size());
+    for (int i = 0; i < (int)order.size(); i++) ret.crossings[i] = D.crossings[order[i]];
+    return ret;
+}
+
+#endif
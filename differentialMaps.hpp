@@ -5,7 +5,13 @@
 #include <map>
 #include <cassert>
 #include <algorithm>
+#include <functional>
+#include <unordered_map>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
 #include "matrices.hpp"
+#include "arena.hpp"
 
 using namespace std;
 
@@ -27,19 +33,6 @@ class PD{
         }
 };
 
-void setMerge(set<int>& a, set<int>& b){ // puts b into a
-    for (int x : b){
-        a.insert(x);
-    }
-}
-
-template<typename T> set<T> setComplement(set<T> a, set<T> b){ // a setminus b
-    for (T x : b){
-        a.erase(x);
-    }
-    return a;
-}
-
 void insertVector(vector<ll> &basis, ll mask) {
     for (ll i = 0; i < basis.size(); i++) {
         if (!(mask & (1ll << i))) continue;
@@ -59,52 +52,318 @@ bool isLinearlyIndependent(const vector<ll> &basis, ll mask){
     return 0;
 }
 
-set<set<int>> resolutionCircles(PD diagram, ll resolution){
-    vector<set<int>> circles;
-    for (int i = 0; i < diagram.size(); i++){
-        vector<pair<int, int>> strandPairings(2);
+class CircleTable{
+    // every circle that shows up in some resolution of one diagram, stored once
+    // as a bitmask of its strands and referred to everywhere else by a dense id.
+    // bit i of a mask stands for strands[i], so circles that are disjoint compare
+    // by their lowest bit exactly the way set<set<int>> ordered them
+    public:
+        vector<int> strands; // strand label of each bit position, increasing
+        vector<vector<int>> crossingBits; // bit positions of the four strands at each crossing
+        vector<ull> masks; // masks[id] is the circle with that id
+        unordered_map<ull, int> ids;
+        CircleTable(PD &diagram){
+            for (auto &crossing : diagram.crossings){
+                for (int x : crossing) strands.push_back(x);
+            }
+            sort(strands.begin(), strands.end());
+            strands.erase(unique(strands.begin(), strands.end()), strands.end());
+            assert(strands.size() <= 64); // one word per circle
+            for (auto &crossing : diagram.crossings){
+                crossingBits.push_back({});
+                for (int x : crossing) crossingBits.back().push_back(bit(x));
+            }
+        }
+        int size() const{
+            return masks.size();
+        }
+        int bit(int strand) const{ // -1 if the strand is not in the diagram
+            auto it = lower_bound(strands.begin(), strands.end(), strand);
+            if (it == strands.end() || *it != strand) return -1;
+            return it - strands.begin();
+        }
+        int intern(ull mask){
+            auto it = ids.find(mask);
+            if (it != ids.end()) return it->second;
+            ids[mask] = masks.size();
+            masks.push_back(mask);
+            return masks.size() - 1;
+        }
+        bool contains(int id, int strand) const{
+            int b = bit(strand);
+            return b != -1 && ((masks[id] >> b) & 1);
+        }
+        ll labelMask(int id) const{ // the circle with strand x at bit x-1, as the annular code expects
+            ll ret = 0;
+            for (ull m = masks[id]; m; m &= m - 1) ret |= (1ll << (strands[__builtin_ctzll(m)] - 1));
+            return ret;
+        }
+};
+
+int resolutionCircles(CircleTable &table, ll resolution, int *out){
+    // writes the ids of the circles of a resolution to out, ordered by their
+    // lowest strand, and returns how many there are (at most 64)
+    int m = table.strands.size();
+    int parent[64];
+    ull masks[64];
+    for (int i = 0; i < m; i++){
+        parent[i] = i;
+        masks[i] = 0;
+    }
+    auto find = [&](int x){
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    };
+    for (int i = 0; i < (int)table.crossingBits.size(); i++){
+        const vector<int> &c = table.crossingBits[i];
         if (!(resolution & (1ll << i))){
             // pair crossing[0] with crossing[1], crossing[2] with crossing[3]
-            strandPairings[0] = {diagram.crossings[i][0], diagram.crossings[i][1]};
-            strandPairings[1] = {diagram.crossings[i][2], diagram.crossings[i][3]};
+            parent[find(c[0])] = find(c[1]);
+            parent[find(c[2])] = find(c[3]);
         }
         else{
             // pair crossing[0] with crossing[3], crossing[1] with crossing[2]
-            strandPairings[0] = {diagram.crossings[i][0], diagram.crossings[i][3]};
-            strandPairings[1] = {diagram.crossings[i][1], diagram.crossings[i][2]};
-        }
-        for (int j = 0; j < 2; j++){
-            bool found = 0;
-            vector<set<int>> toMerge; // merge circles that have overlapping strands
-            for (int i = 0; (ull) i < circles.size(); i++){
-                set<int> circle = circles[i];
-                if (circle.count(strandPairings[j].first) || circle.count(strandPairings[j].second)){
-                    found = 1;
-                    toMerge.push_back(circles[i]);
-                    circles.erase(circles.begin() + i);
-                    i--;
-                }
-            }
-            while (toMerge.size() > 1){
-                setMerge(toMerge[0], toMerge.back());
-                toMerge.pop_back();
-            }
-            if (toMerge.size()){
-                toMerge[0].insert(strandPairings[j].first);
-                toMerge[0].insert(strandPairings[j].second);
-                circles.push_back(toMerge[0]);
+            parent[find(c[0])] = find(c[3]);
+            parent[find(c[1])] = find(c[2]);
+        }
+    }
+    for (int i = 0; i < m; i++) masks[find(i)] |= (1ull << i);
+    int count = 0;
+    for (int i = 0; i < m; i++){
+        if (__builtin_ctzll(masks[find(i)]) == i) out[count++] = table.intern(masks[find(i)]);
+    }
+    return count;
+}
+
+vector<ll> chainGroupSizes(PD D, bool reducedHomology){
+    // basisStartCount of the builders, the dimension of every chain group,
+    // from the circle counts alone and without keeping the cube
+    int n = D.size();
+    int marked = reducedHomology ? 1 : 0;
+    CircleTable table(D);
+    vector<ll> sizes(n+1, 0);
+    int circles[64];
+    for (ll resolution = 0; resolution < (1ll << n); resolution++){
+        int count = resolutionCircles(table, resolution, circles);
+        sizes[__builtin_popcountll(resolution)] += (1ll << (count - marked));
+    }
+    return sizes;
+}
+
+class CircleList{
+    // the circles of one resolution, stored in the arena of its cube
+    public:
+        const int *ids = nullptr;
+        int count = 0;
+        int size() const{
+            return count;
+        }
+        int operator[](int t) const{
+            return ids[t];
+        }
+        const int* begin() const{
+            return ids;
+        }
+        const int* end() const{
+            return ids + count;
+        }
+};
+
+bool reportCubeStats = 0; // print the arena usage of every cube to stderr once it is released
+
+class ResolutionCube{
+    // the circles of all 2^n resolutions of a diagram; every list lives in one
+    // arena, so building the cube makes a handful of large allocations instead
+    // of one per resolution, and all of it is freed together with the cube
+    private:
+        Arena arena;
+        CircleList *lists;
+        ll resolutions;
+    public:
+        ResolutionCube(CircleTable &table, int n) : resolutions(1ll << n){
+            lists = arena.allocate<CircleList>(resolutions);
+            int circles[64];
+            for (ll i = 0; i < resolutions; i++){
+                int count = resolutionCircles(table, i, circles);
+                int *ids = arena.allocate<int>(count);
+                copy(circles, circles + count, ids);
+                lists[i].ids = ids;
+                lists[i].count = count;
             }
-            if (!found){
-                set<int> newCircle{strandPairings[j].first, strandPairings[j].second};
-                circles.push_back(newCircle);
+        }
+        ResolutionCube(const ResolutionCube&) = delete;
+        ResolutionCube& operator=(const ResolutionCube&) = delete;
+        ~ResolutionCube(){
+            if (reportCubeStats) cerr << "resolution cube: " << arena.stats() << endl;
+        }
+        const CircleList& operator[](ll resolution) const{
+            return lists[resolution];
+        }
+        ll size() const{
+            return resolutions;
+        }
+        const ArenaStats& stats() const{
+            return arena.stats();
+        }
+};
+
+class CirclePositions{
+    // position of each circle id within one resolution, so the merge/split
+    // loops can look circles up in O(1); only the current resolution's entries
+    // are ever set, so loading another one costs as much as its circle count
+    private:
+        vector<int> position; // position + 1, 0 when the circle is absent
+        const CircleList *loaded = nullptr;
+        int first = 0;
+    public:
+        CirclePositions(int numCircles) : position(numCircles, 0) {}
+        void load(const CircleList &circles, int firstPosition = 0){
+            // firstPosition is the position given to the first circle
+            if (loaded){
+                for (int id : *loaded) position[id] = 0;
             }
+            loaded = &circles;
+            first = firstPosition;
+            for (int t = 0; t < (int)circles.size(); t++) position[circles[t]] = t + 1;
+        }
+        bool contains(int id) const{
+            return position[id] != 0;
+        }
+        ll operator[](int id) const{
+            return position[id] - 1 + first;
+        }
+};
+
+ull extractBits(ull x, ull mask){ // the bits of x under mask, packed into the low bits (pext)
+#ifdef __BMI2__
+    return _pext_u64(x, mask);
+#else
+    ull ret = 0;
+    for (int i = 0; mask; mask &= mask - 1, i++){
+        if (x & mask & -mask) ret |= (1ull << i);
+    }
+    return ret;
+#endif
+}
+
+ull depositBits(ull x, ull mask){ // the low bits of x spread over the set bits of mask (pdep)
+#ifdef __BMI2__
+    return _pdep_u64(x, mask);
+#else
+    ull ret = 0;
+    for (int i = 0; mask; mask &= mask - 1, i++){
+        if ((x >> i) & 1) ret |= mask & -mask;
+    }
+    return ret;
+#endif
+}
+
+class CubeEdge{
+    // what happens to the circles along the edge from a resolution to the one
+    // with crossing j switched on. positions are within each resolution, in
+    // increasing order; circles not involved keep their relative order, so
+    // moving them is one extract followed by one deposit
+    public:
+        bool merge = 0, split = 0;
+        int oldSlots[2] = {-1, -1}; // the two circles that merge, or the one that splits
+        int newSlots[2] = {-1, -1}; // the merged circle, or the two halves of the split
+        ull keep = 0; // positions of the surviving circles in the old resolution
+        ull place = 0; // positions the survivors take in the new resolution
+        ull moveSurvivors(ull subset, int marked = 0) const{
+            // subset of old circles -> the same survivors in the new resolution;
+            // marked = 1 when the first circle carries no bit, as in the reduced complex
+            return depositBits(extractBits(subset, keep >> marked), place >> marked);
+        }
+};
+
+CubeEdge cubeEdge(const CircleList &oldCircles, const CircleList &newCircles, const CirclePositions &oldPositions, const CirclePositions &newPositions){
+    // the record for one edge; oldPositions and newPositions should hold the
+    // two resolutions it joins
+    CubeEdge edge;
+    int oldCount = 0, newCount = 0;
+    for (int t = 0; t < (int)oldCircles.size(); t++){
+        if (!newPositions.contains(oldCircles[t])){
+            if (oldCount < 2) edge.oldSlots[oldCount] = t;
+            oldCount++;
+        }
+        else{
+            edge.keep |= (1ull << t);
+            edge.place |= (1ull << newPositions[oldCircles[t]]);
+        }
+    }
+    for (int t = 0; t < (int)newCircles.size(); t++){
+        if (!oldPositions.contains(newCircles[t])){
+            if (newCount < 2) edge.newSlots[newCount] = t;
+            newCount++;
+        }
+    }
+    edge.merge = (oldCount == 2 && newCount == 1);
+    edge.split = (oldCount == 1 && newCount == 2);
+    return edge;
+}
+
+vector<CubeEdge> cubeEdgeTable(const CircleTable &table, const ResolutionCube &resolutionCube, int n){
+    // ret[resolution * n + j] describes the edge that switches on crossing j,
+    // and is left empty when crossing j is already on in resolution
+    vector<CubeEdge> ret((1ll << n) * n);
+    CirclePositions oldPositions(table.size()), newPositions(table.size());
+    for (ll resolution = 0; resolution < (1ll << n); resolution++){
+        const CircleList &oldCircles = resolutionCube[resolution];
+        oldPositions.load(oldCircles);
+        for (int j = 0; j < n; j++){
+            if (resolution & (1ll << j)) continue;
+            const CircleList &newCircles = resolutionCube[resolution | (1ll << j)];
+            newPositions.load(newCircles);
+            ret[resolution * n + j] = cubeEdge(oldCircles, newCircles, oldPositions, newPositions);
         }
     }
-    set<set<int>> ret;
-    for (auto s : circles) ret.insert(s);
     return ret;
 }
 
+int differentialImages(const CubeEdge &edge, ll subset, bool reducedHomology, ll *images){
+    // writes the images of one generator along edge to images, as subsets of
+    // the new resolution's circles, and returns how many there are (at most 2).
+    // subset marks the (+) circles of the old resolution, (-) <-> 0, (+) <-> 1.
+    // in the reduced complex the marked circle is position 0 of every
+    // resolution and has no bit, so every position is one less than recorded
+    int m = reducedHomology ? 1 : 0;
+    ll moved = edge.moveSurvivors(subset, m); // the circles that do not take part keep their status
+    if (reducedHomology && edge.oldSlots[0] == 0){ // contains X in the merge/split
+        if (edge.merge){ // the other circle is absorbed into the marked one
+            images[0] = moved;
+            return 1;
+        }
+        if (edge.split){ // the marked circle stays first, the new circle gets both statuses
+            images[0] = moved;
+            images[1] = moved + (1ll << (edge.newSlots[1] - m));
+            return 2;
+        }
+        return 0;
+    }
+    if (edge.merge){
+        // (-) x (-) -> (-); (-) x (+) = (+) x (-) -> (+), (+) x (+) -> (-)
+        // rule based on Audoux's notation
+        bool newCircleStatus = ((subset >> (edge.oldSlots[0] - m)) ^ (subset >> (edge.oldSlots[1] - m))) & 1;
+        images[0] = moved + (newCircleStatus ? (1ll << (edge.newSlots[0] - m)) : 0);
+        return 1;
+    }
+    if (edge.split){
+        // (+) -> (+)(+) + (-)(-); (-) -> (-)(+) + (+)(-)
+        // based on Audoux's notation
+        ll first = (1ll << (edge.newSlots[0] - m)), second = (1ll << (edge.newSlots[1] - m));
+        if ((subset >> (edge.oldSlots[0] - m)) & 1){ // (+) ->
+            images[0] = moved;
+            images[1] = moved + first + second;
+        }
+        else{ // (-) ->
+            images[0] = moved + first;
+            images[1] = moved + second;
+        }
+        return 2;
+    }
+    return 0;
+}
+
 PD readPlanarDiagram(int n){ // reads planar diagram, given n crossings
 // space-separated
     PD D(n);
@@ -116,7 +375,7 @@ PD readPlanarDiagram(int n){ // reads planar diagram, given n crossings
     return D;
 }
 
-PD createPlanarDiagram(vector<vector<int>> &crossings){ // crossings[i].size() should be 4
+PD createPlanarDiagram(const vector<vector<int>> &crossings){ // crossings[i].size() should be 4
     PD D(crossings.size());
     for (int i = 0; i < crossings.size(); i++){
         for (int j = 0; j < 4; j++){
@@ -144,16 +403,14 @@ vector<Matrix> regularDifferentialMaps(PD D){
     // }
 
     // testing if resolutionCircles produces correct circles
-    // set<set<int>> res = resolutionCircles(D, 2);
+    // vector<int> res = resolutionCircles(table, 2);
     // cout << res.size() << endl;
 
     // construct resolution cube
     int n = D.size();
-    vector<set<set<int>>> resolutionCube(1ll << n);
-    for (ll i = 0; i < (1ll << n); i++){
-        resolutionCube[i] = resolutionCircles(D, i);
-        // cerr << i << ": " << resolutionCube[i].size() << endl;
-    }
+    CircleTable table(D);
+    ResolutionCube resolutionCube(table, n);
+    // for (ll i = 0; i < (1ll << n); i++) cerr << i << ": " << resolutionCube[i].size() << endl;
 
     vector<ll> ordering((1ll << n));
     vector<ll> circleStartingIndex((1ll << n));
@@ -184,91 +441,22 @@ vector<Matrix> regularDifferentialMaps(PD D){
         differentialMap[i] = Matrix(basisStartCount[i], basisStartCount[i+1]);
     }
 
-    vector<map<set<int>, ll>> resolutionCircleIndices(1ll << n);
-    // get the circle indices of everything in a resolution
-
-    vector<vector<set<int>>> resolutionCirclesVector(1ll << n);
-    // store the circles of a resolution in order in a vector
-
-    for (ll resolution = 0; resolution < (1ll << n); resolution++){
-        ll count = 0;
-        for (auto x : resolutionCube[resolution]){
-            resolutionCircleIndices[resolution][x] = count++;
-            resolutionCirclesVector[resolution].push_back(x);
-        }
-    }
+    vector<CubeEdge> edges = cubeEdgeTable(table, resolutionCube, n);
+    // how the circles change along every edge of the cube
 
     for (ll resolution = 0; resolution < (1ll << n); resolution++){
         for (int j = 0; j < n; j++){
             if ((resolution & (1ll << j)) != 0) continue; // jth bit already set
             // jth bit not yet set
             ll newResolution = resolution | (1ll << j);
-            set<set<int>> oldCircles = resolutionCube[resolution];
-            set<set<int>> newCircles = resolutionCube[newResolution];
+            const CubeEdge &edge = edges[resolution * n + j];
+            Matrix &d = differentialMap[__builtin_popcountll(resolution)];
 
-            set<set<int>> oldDiff = setComplement<set<int>>(oldCircles, newCircles);
-            set<set<int>> newDiff = setComplement<set<int>>(newCircles, oldCircles);
-
-            for (ll oldCirclesSubset = 0; oldCirclesSubset < (1ll << oldCircles.size()); oldCirclesSubset++){
+            for (ll oldCirclesSubset = 0; oldCirclesSubset < (1ll << resolutionCube[resolution].size()); oldCirclesSubset++){
                 ll oldIndex = circleStartingIndex[resolution] + oldCirclesSubset;
-                // (-) <-> 0, (+) <-> 1
-                if (oldDiff.size() == 2){ // exactly 2 circles in the old resolution not in the new resolution
-                    // must be a merge
-                    // (-) x (-) -> (-); (-) x (+) = (+) x (-) -> (+), (+) x (+) -> (-)
-                    bool circleOneStatus = ((oldCirclesSubset 
-                    & (1ll << resolutionCircleIndices[resolution][*(oldDiff.begin())])) != 0);
-                    bool circleTwoStatus = ((oldCirclesSubset 
-                    & (1ll << resolutionCircleIndices[resolution][*(++oldDiff.begin())])) != 0);
-
-                    bool newCircleStatus = circleOneStatus ^ circleTwoStatus;
-                    // rule based on Audoux's notation
-
-                    ll newCircleIndex = circleStartingIndex[newResolution];
-                    // update index for the new merged circle
-                    if (newCircleStatus) newCircleIndex += (1ll << resolutionCircleIndices[newResolution][*newDiff.begin()]);
-                    for (ll oldCirclesIndex = 0; (ull) oldCirclesIndex < oldCircles.size(); oldCirclesIndex++){
-                        if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                            if (newCircles.count(resolutionCirclesVector[resolution][oldCirclesIndex])){
-                                newCircleIndex += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex]]);
-                            }
-                        }
-                    }
-
-                    differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex] = 1;
-                }
-                else if (oldDiff.size() == 1){ // must be a split
-                    // (+) -> (+)(+) + (-)(-); (-) -> (-)(+) + (+)(-)
-                    // based on Audoux's notation
-
-                    ll newCircleIndex1 = circleStartingIndex[newResolution];
-                    ll newCircleIndex2 = circleStartingIndex[newResolution];
-                    for (ll oldCirclesIndex = 0; (ull) oldCirclesIndex < oldCircles.size(); oldCirclesIndex++){
-                        if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                            if (newCircles.count(resolutionCirclesVector[resolution][oldCirclesIndex])){
-                                newCircleIndex1 += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex]]);
-                                newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex]]);
-                            }
-                        }
-                    }
-
-                    // implementing (+) ->
-                    if (oldCirclesSubset & (1ll << resolutionCircleIndices[resolution][*oldDiff.begin()])){ // (+) ->
-                        // newCircleIndex1: (-)(-), newCircleIndex2: (+)(+)
-                        newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][*newDiff.begin()]);
-                        newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][*(++newDiff.begin())]);
-
-                        differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex1] = 1;
-                        differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex2] = 1;
-                    }
-                    else{ // (-) ->
-                        // newCircleIndex1: (+)(-), newCircleIndex2: (-)(+)
-                        newCircleIndex1 += (1ll << resolutionCircleIndices[newResolution][*newDiff.begin()]);
-                        newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][*(++newDiff.begin())]);
-
-                        differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex1] = 1;
-                        differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex2] = 1;
-                    }
-                }
+                ll images[2];
+                int count = differentialImages(edge, oldCirclesSubset, 0, images);
+                for (int k = 0; k < count; k++) d[oldIndex][circleStartingIndex[newResolution] + images[k]] = 1;
             }
         }
     }
@@ -287,11 +475,9 @@ vector<Matrix> reducedDifferentialMaps(PD D){
 
     // construct resolution cube
     // int n = D.size();
-    vector<set<set<int>>> resolutionCube(1ll << n);
-    for (ll i = 0; i < (1ll << n); i++){
-        resolutionCube[i] = resolutionCircles(D, i);
-        // cerr << i << ": " << resolutionCube[i].size() << endl;
-    }
+    CircleTable table(D);
+    ResolutionCube resolutionCube(table, n);
+    // for (ll i = 0; i < (1ll << n); i++) cerr << i << ": " << resolutionCube[i].size() << endl;
 
     vector<ll> ordering((1ll << n));
     vector<ll> circleStartingIndex((1ll << n));
@@ -321,132 +507,96 @@ vector<Matrix> reducedDifferentialMaps(PD D){
         differentialMap[i] = Matrix(basisStartCount[i], basisStartCount[i+1]);
     }
 
-    vector<map<set<int>, ll>> resolutionCircleIndices(1ll << n);
-    // get the circle indices of everything in a resolution
-
-    vector<vector<set<int>>> resolutionCirclesVector(1ll << n);
-    // store the circles of a resolution in order in a vector
-
-    for (ll resolution = 0; resolution < (1ll << n); resolution++){
-        ll count = -1;
-        for (auto x : resolutionCube[resolution]){
-            resolutionCircleIndices[resolution][x] = count++;
-            resolutionCirclesVector[resolution].push_back(x);
-        }
-    }
+    vector<CubeEdge> edges = cubeEdgeTable(table, resolutionCube, n);
+    // how the circles change along every edge of the cube
 
     for (ll resolution = 0; resolution < (1ll << n); resolution++){
         for (int j = 0; j < n; j++){
             if ((resolution & (1ll << j)) != 0) continue; // jth bit already set
             // jth bit not yet set
             ll newResolution = resolution | (1ll << j);
-            set<set<int>> oldCircles = resolutionCube[resolution];
-            set<set<int>> newCircles = resolutionCube[newResolution];
+            const CubeEdge &edge = edges[resolution * n + j];
+            Matrix &d = differentialMap[__builtin_popcountll(resolution)];
 
-            set<set<int>> oldDiff = setComplement<set<int>>(oldCircles, newCircles);
-            set<set<int>> newDiff = setComplement<set<int>>(newCircles, oldCircles);
-
-            bool containsX = 0;
-            for (auto x : oldDiff){
-                if (x.count(1)) containsX = 1;
+            for (ll oldCirclesSubset = 0; oldCirclesSubset < (1ll << (resolutionCube[resolution].size()-1)); oldCirclesSubset++){
+                ll oldIndex = circleStartingIndex[resolution] + oldCirclesSubset;
+                ll images[2];
+                int count = differentialImages(edge, oldCirclesSubset, 1, images);
+                for (int k = 0; k < count; k++) d[oldIndex][circleStartingIndex[newResolution] + images[k]] = 1;
             }
+        }
+    }
 
-            if (!containsX){
-                for (ll oldCirclesSubset = 0; oldCirclesSubset < (1ll << (oldCircles.size()-1)); oldCirclesSubset++){
-                    ll oldIndex = circleStartingIndex[resolution] + oldCirclesSubset;
-                    // (-) <-> 0, (+) <-> 1
-                    if (oldDiff.size() == 2){ // exactly 2 circles in the old resolution not in the new resolution
-                        // must be a merge
-                        // (-) x (-) -> (-); (-) x (+) = (+) x (-) -> (+), (+) x (+) -> (-)
-                        bool circleOneStatus = ((oldCirclesSubset 
-                        & (1ll << resolutionCircleIndices[resolution][*(oldDiff.begin())])) != 0);
-                        bool circleTwoStatus = ((oldCirclesSubset 
-                        & (1ll << resolutionCircleIndices[resolution][*(++oldDiff.begin())])) != 0);
-
-                        bool newCircleStatus = circleOneStatus ^ circleTwoStatus;
-                        // rule based on Audoux's notation
-
-                        ll newCircleIndex = circleStartingIndex[newResolution];
-                        // update index for the new merged circle
-                        if (newCircleStatus) newCircleIndex += (1ll << resolutionCircleIndices[newResolution][*newDiff.begin()]);
-                        for (ll oldCirclesIndex = 0; oldCirclesIndex < oldCircles.size() - 1ll; oldCirclesIndex++){
-                            if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                                if (newCircles.count(resolutionCirclesVector[resolution][oldCirclesIndex + 1])){
-                                    newCircleIndex += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex + 1]]);
-                                }
-                            }
-                        }
+    return differentialMap;
+}
 
-                        differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex] = 1;
-                    }
-                    else if (oldDiff.size() == 1){ // must be a split
-                        // (+) -> (+)(+) + (-)(-); (-) -> (-)(+) + (+)(-)
-                        // based on Audoux's notation
-
-                        ll newCircleIndex1 = circleStartingIndex[newResolution];
-                        ll newCircleIndex2 = circleStartingIndex[newResolution];
-                        for (ll oldCirclesIndex = 0; oldCirclesIndex < oldCircles.size()-1ll; oldCirclesIndex++){
-                            if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                                if (newCircles.count(resolutionCirclesVector[resolution][oldCirclesIndex + 1])){
-                                    newCircleIndex1 += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex + 1]]);
-                                    newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex + 1]]);
-                                }
-                            }
-                        }
+class DifferentialMapPair{
+    public:
+        vector<Matrix> regular, reduced;
+};
 
-                        // implementing (+) ->
-                        if (oldCirclesSubset & (1ll << resolutionCircleIndices[resolution][*oldDiff.begin()])){ // (+) ->
-                            // newCircleIndex1: (-)(-), newCircleIndex2: (+)(+)
-                            newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][*newDiff.begin()]);
-                            newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][*(++newDiff.begin())]);
+ll dropBit(ll x, int p){ // x without bit p, the higher bits moved down one place
+    return (x & ((1ll << p) - 1)) | ((x >> (p + 1)) << p);
+}
 
-                            differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex1] = 1;
-                            differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex2] = 1;
-                        }
-                        else{ // (-) ->
-                            // newCircleIndex1: (+)(-), newCircleIndex2: (-)(+)
-                            newCircleIndex1 += (1ll << resolutionCircleIndices[newResolution][*newDiff.begin()]);
-                            newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][*(++newDiff.begin())]);
+DifferentialMapPair regularAndReducedDifferentialMaps(PD D, int markedStrand = 0){
+    // the maps of regularDifferentialMaps and of reducedDifferentialMaps from
+    // one cube, with the marked point on markedStrand (0 for the smallest
+    // label, as reducedDifferentialMaps has it). (-) is the unit here (see
+    // differentialImages), so the reduced complex is the subcomplex where the
+    // marked circle carries (+) + (-): its generator s is the sum of the two
+    // regular generators that agree with s off the marked circle, and its
+    // image is the image of the one with (-) there, with the marked circle's
+    // status forgotten. the marked circle has no bit and the others keep
+    // their order, which for the smallest strand is reducedDifferentialMaps'
+    // numbering exactly
+    int n = D.size();
+    CircleTable table(D);
+    if (markedStrand == 0) markedStrand = table.strands[0];
+    assert(table.bit(markedStrand) != -1);
+    ResolutionCube resolutionCube(table, n);
+
+    vector<ll> regularStart(1ll << n), reducedStart(1ll << n);
+    vector<int> markedPosition(1ll << n, 0); // position of the marked circle in every resolution
+    vector<ll> regularCount(n+1, 0), reducedCount(n+1, 0);
+    for (ll i = 0; i < (1ll << n); i++){
+        const CircleList &circles = resolutionCube[i];
+        for (int t = 0; t < circles.size(); t++) if (table.contains(circles[t], markedStrand)) markedPosition[i] = t;
+        int k = __builtin_popcountll(i);
+        regularStart[i] = regularCount[k];
+        regularCount[k] += 1ll << circles.size();
+        reducedStart[i] = reducedCount[k];
+        reducedCount[k] += 1ll << (circles.size() - 1);
+    }
 
-                            differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex1] = 1;
-                            differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex2] = 1;
-                        }
-                    }
-                }
-            }
-            else { // contains X in the merge/split
-                for (ll oldCirclesSubset = 0; oldCirclesSubset < (1ll << (oldCircles.size()-1)); oldCirclesSubset++){
-                    ll oldIndex = circleStartingIndex[resolution] + oldCirclesSubset;
-                    if (oldDiff.size() == 2){ // must be a merge
-                        ll newCircleIndex = circleStartingIndex[newResolution];
-                        for (ll oldCirclesIndex = 0; oldCirclesIndex < oldCircles.size() - 1ll; oldCirclesIndex++){
-                            if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                                if (!oldDiff.count(resolutionCirclesVector[resolution][oldCirclesIndex + 1])){
-                                    newCircleIndex += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex + 1]]);
-                                }
-                            }
-                        }
-                        differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex] = 1;
-                    }
-                    else if (oldDiff.size() == 1){ // must be a split
-                        ll newCircleIndex1 = circleStartingIndex[newResolution];
-                        ll newCircleIndex2 = circleStartingIndex[newResolution];
-                        for (ll oldCirclesIndex = 0; oldCirclesIndex < oldCircles.size() - 1ll; oldCirclesIndex++){
-                            if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                                newCircleIndex1 += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex + 1]]);
-                                newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex + 1]]);
-                            }
-                        }
-                        newCircleIndex2 += (1ll << resolutionCircleIndices[newResolution][*(++newDiff.begin())]);
-                        differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex1] = 1;
-                        differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex2] = 1;
-                    }
+    DifferentialMapPair ret;
+    for (int i = 0; i < n; i++){
+        ret.regular.push_back(Matrix(regularCount[i], regularCount[i+1]));
+        ret.reduced.push_back(Matrix(reducedCount[i], reducedCount[i+1]));
+    }
+
+    vector<CubeEdge> edges = cubeEdgeTable(table, resolutionCube, n);
+    for (ll resolution = 0; resolution < (1ll << n); resolution++){
+        int p = markedPosition[resolution];
+        Matrix &regular = ret.regular[__builtin_popcountll(resolution)];
+        Matrix &reduced = ret.reduced[__builtin_popcountll(resolution)];
+        for (int j = 0; j < n; j++){
+            if ((resolution & (1ll << j)) != 0) continue;
+            ll newResolution = resolution | (1ll << j);
+            const CubeEdge &edge = edges[resolution * n + j];
+            int q = markedPosition[newResolution];
+            for (ll subset = 0; subset < (1ll << resolutionCube[resolution].size()); subset++){
+                ll images[2];
+                int count = differentialImages(edge, subset, 0, images);
+                for (int k = 0; k < count; k++) regular[regularStart[resolution] + subset][regularStart[newResolution] + images[k]] = 1;
+                if ((subset >> p) & 1) continue; // (+) on the marked circle
+                for (int k = 0; k < count; k++){
+                    reduced[reducedStart[resolution] + dropBit(subset, p)][reducedStart[newResolution] + dropBit(images[k], q)] = 1;
                 }
             }
         }
     }
-
-    return differentialMap;
+    return ret;
 }
 
 PD getPlanarDiagram(){
@@ -476,14 +626,143 @@ vector<Matrix> getMaps(PD D, bool reducedHomology){
 }
 
 
+class DiagramSymmetry{
+    public:
+        map<int, int> strandImage;
+        vector<int> crossingImage; // crossing i is carried to crossing crossingImage[i]
+};
+
+vector<DiagramSymmetry> diagramAutomorphisms(PD D, bool fixStrandOne){
+    // relabelings of strands and crossings that carry the crossing list to
+    // itself, where a crossing tuple may also be rotated by two positions since
+    // that keeps both of its resolutions. the image of crossing 0 decides
+    // everything else through the strands, so there are at most 2n candidates.
+    // only connected diagrams are handled; for reduced homology strand 1 has to
+    // stay fixed so the marked circle does
+    int n = D.size();
+    vector<DiagramSymmetry> ret;
+    if (!n) return ret;
+    map<int, vector<pair<int, int>>> slots; // strand -> (crossing, position) of both of its ends
+    for (int x = 0; x < n; x++){
+        for (int s = 0; s < 4; s++) slots[D.crossings[x][s]].push_back({x, s});
+    }
+    auto otherEnd = [&](int strand, pair<int, int> end){
+        auto &ends = slots[strand];
+        if (ends.size() != 2) return make_pair(-1, -1);
+        return ends[0] == end ? ends[1] : ends[0];
+    };
+    for (int y0 = 0; y0 < n; y0++){
+        for (int rot0 = 0; rot0 < 4; rot0 += 2){
+            DiagramSymmetry symmetry;
+            symmetry.crossingImage.assign(n, -1);
+            vector<int> rotation(n, 0);
+            symmetry.crossingImage[0] = y0;
+            rotation[0] = rot0;
+            vector<int> queue = {0};
+            bool good = 1;
+            for (int q = 0; q < (int)queue.size() && good; q++){
+                int x = queue[q], y = symmetry.crossingImage[x], r = rotation[x];
+                for (int s = 0; s < 4 && good; s++){
+                    int e = D.crossings[x][s], f = D.crossings[y][(s + r) % 4];
+                    if (symmetry.strandImage.count(e) && symmetry.strandImage[e] != f){
+                        good = 0;
+                        break;
+                    }
+                    symmetry.strandImage[e] = f;
+                    pair<int, int> from = otherEnd(e, {x, s}), to = otherEnd(f, {y, (s + r) % 4});
+                    if (from.first == -1 || to.first == -1){
+                        good = (from.first == to.first);
+                        continue;
+                    }
+                    int r2 = (to.second - from.second + 4) % 4;
+                    if (r2 % 2){
+                        good = 0;
+                    }
+                    else if (symmetry.crossingImage[from.first] == -1){
+                        symmetry.crossingImage[from.first] = to.first;
+                        rotation[from.first] = r2;
+                        queue.push_back(from.first);
+                    }
+                    else if (symmetry.crossingImage[from.first] != to.first || rotation[from.first] != r2){
+                        good = 0;
+                    }
+                }
+            }
+            if (!good || (int)queue.size() != n) continue;
+            set<int> images(symmetry.crossingImage.begin(), symmetry.crossingImage.end());
+            if ((int)images.size() != n) continue;
+            if (fixStrandOne && symmetry.strandImage.count(1) && symmetry.strandImage[1] != 1) continue;
+            ret.push_back(symmetry);
+        }
+    }
+    return ret;
+}
+
+vector<vector<vector<ll>>> generatorPermutations(PD D, bool reducedHomology){
+    // for every diagram symmetry, the permutation it induces on the generators
+    // of each degree, indexed the same way as regularDifferentialMaps and
+    // reducedDifferentialMaps. ret[g][i][j] is the image of generator j in degree i
+    int n = D.size();
+    vector<DiagramSymmetry> symmetries = diagramAutomorphisms(D, reducedHomology);
+    CircleTable table(D);
+    ResolutionCube resolutionCube(table, n);
+    int marked = reducedHomology ? 1 : 0; // circle 0 holds strand 1 and carries no bit in the reduced complex
+    vector<ll> circleStartingIndex(1ll << n);
+    vector<ll> basisStartCount(n+1, 0);
+    for (ll i = 0; i < (1ll << n); i++){
+        circleStartingIndex[i] = basisStartCount[__builtin_popcountll(i)];
+        basisStartCount[__builtin_popcountll(i)] += (1ll << (resolutionCube[i].size() - marked));
+    }
+
+    vector<vector<vector<ll>>> ret;
+    CirclePositions newPositions(table.size());
+    for (auto &symmetry : symmetries){
+        vector<int> bitImage(table.strands.size());
+        for (int b = 0; b < (int)table.strands.size(); b++) bitImage[b] = table.bit(symmetry.strandImage[table.strands[b]]);
+        vector<int> imageId(table.size(), -1); // filled in as circles come up
+        vector<vector<ll>> perm(n+1);
+        for (int i = 0; i <= n; i++) perm[i].resize(basisStartCount[i]);
+        for (ll resolution = 0; resolution < (1ll << n); resolution++){
+            ll newResolution = 0;
+            for (int j = 0; j < n; j++){
+                if (resolution & (1ll << j)) newResolution |= (1ll << symmetry.crossingImage[j]);
+            }
+            auto &oldCircles = resolutionCube[resolution];
+            auto &newCircles = resolutionCube[newResolution];
+            newPositions.load(newCircles);
+            vector<int> position(oldCircles.size());
+            for (int t = 0; t < (int)oldCircles.size(); t++){
+                int &image = imageId[oldCircles[t]];
+                if (image == -1){
+                    ull mask = 0;
+                    for (ull m = table.masks[oldCircles[t]]; m; m &= m - 1) mask |= (1ull << bitImage[__builtin_ctzll(m)]);
+                    auto it = table.ids.find(mask);
+                    assert(it != table.ids.end());
+                    image = it->second;
+                }
+                assert(newPositions.contains(image));
+                position[t] = newPositions[image];
+            }
+            int degree = __builtin_popcountll(resolution);
+            for (ll subset = 0; subset < (1ll << (oldCircles.size() - marked)); subset++){
+                ll newSubset = 0;
+                for (int t = marked; t < (int)oldCircles.size(); t++){
+                    if (subset & (1ll << (t - marked))) newSubset |= (1ll << (position[t] - marked));
+                }
+                perm[degree][circleStartingIndex[resolution] + subset] = circleStartingIndex[newResolution] + newSubset;
+            }
+        }
+        ret.push_back(perm);
+    }
+    return ret;
+}
+
+
 // annular stuff below
 
 namespace annular{
-    bool containsPuncture(const set<int> &circle, const vector<ll> &basis1, const vector<ll> &basis2){
-        ll mask = 0;
-        for (auto x : circle){
-            mask += (1ll << (x-1));
-        }
+    bool containsPuncture(ll mask, const vector<ll> &basis1, const vector<ll> &basis2){
+        // mask has bit x-1 set for every strand x of the circle
         if (isLinearlyIndependent(basis2, mask)){
             cerr << "Issue with faces and/or crossings. Please check input." << endl;
             exit(1);
@@ -500,9 +779,16 @@ namespace annular{
         return first;
     }
 
-    vector<bool> annularMerge(const set<int> &circle1, bool circle1Status, const set<int> &circle2, bool circle2Status, const vector<ll> &basis1, const vector<ll> &basis2){
-        bool circle1HasPuncture = containsPuncture(circle1, basis1, basis2);
-        bool circle2HasPuncture = containsPuncture(circle2, basis1, basis2);
+    vector<bool> punctures(const CircleTable &table, const vector<ll> &basis1, const vector<ll> &basis2){
+        // whether each interned circle goes around the puncture, decided once per circle
+        vector<bool> ret(table.size());
+        for (int id = 0; id < table.size(); id++) ret[id] = containsPuncture(table.labelMask(id), basis1, basis2);
+        return ret;
+    }
+
+    vector<bool> annularMerge(int circle1, bool circle1Status, int circle2, bool circle2Status, const vector<bool> &hasPuncture){
+        bool circle1HasPuncture = hasPuncture[circle1];
+        bool circle2HasPuncture = hasPuncture[circle2];
         if (circle1HasPuncture && circle2HasPuncture){
             return mapVVtoA(circle1Status, circle2Status);
         }
@@ -522,10 +808,10 @@ namespace annular{
         return {{first, 0}, {first, 1}};
     }
 
-    vector<pair<bool, bool>> annularSplit(const set<int> &circle, bool circleStatus, const set<int> &res1, const set<int> &res2, const vector<ll> &basis1, const vector<ll> &basis2){
-        bool origHasPuncture = containsPuncture(circle, basis1, basis2);
-        bool res1HasPuncture = containsPuncture(res1, basis1, basis2);
-        bool res2HasPuncture = containsPuncture(res2, basis1, basis2);
+    vector<pair<bool, bool>> annularSplit(int circle, bool circleStatus, int res1, int res2, const vector<bool> &hasPuncture){
+        bool origHasPuncture = hasPuncture[circle];
+        bool res1HasPuncture = hasPuncture[res1];
+        bool res2HasPuncture = hasPuncture[res2];
         if (!origHasPuncture && !res1HasPuncture && !res2HasPuncture){ // regular split
             if (circleStatus){ // (+) -> (-)(-) + (+)(+)
                 return {{0, 0}, {1, 1}};
@@ -578,17 +864,18 @@ namespace annular{
         basis2 = basis1;
         insertVector(basis2, specialMask);
 
-        vector<set<set<int>>> resolutionCube(1ll << n);
-        for (ll i = 0; i < (1ll << n); i++){
-            resolutionCube[i] = resolutionCircles(D, i);
-            // test puncture detection
-            // for (auto circle : resolutionCube[i]){
-            //     if (containsPuncture(circle, basis1, basis2)){
-            //         for (auto x : circle) cerr << x << ' ';
-            //         cerr << endl;
-            //     }
-            // }
-        }
+        CircleTable table(D);
+        ResolutionCube resolutionCube(table, n);
+        // test puncture detection
+        // for (ll i = 0; i < (1ll << n); i++){
+        //     for (auto circle : resolutionCube[i]){
+        //         if (containsPuncture(table.labelMask(circle), basis1, basis2)){
+        //             for (auto x : table.strands) if (table.contains(circle, x)) cerr << x << ' ';
+        //             cerr << endl;
+        //         }
+        //     }
+        // }
+        vector<bool> hasPuncture = punctures(table, basis1, basis2);
         
         vector<ll> ordering((1ll << n));
         vector<ll> circleStartingIndex((1ll << n));
@@ -607,79 +894,47 @@ namespace annular{
             differentialMap[i] = Matrix(basisStartCount[i], basisStartCount[i+1]);
         }
 
-        vector<map<set<int>, ll>> resolutionCircleIndices(1ll << n);
-        vector<vector<set<int>>> resolutionCirclesVector(1ll << n);
-
-        for (ll resolution = 0; resolution < (1ll << n); resolution++){
-            ll count = 0;
-            for (auto x : resolutionCube[resolution]){
-                resolutionCircleIndices[resolution][x] = count++;
-                resolutionCirclesVector[resolution].push_back(x);
-            }
-        }
-
+        vector<CubeEdge> edges = cubeEdgeTable(table, resolutionCube, n);
+        // how the circles change along every edge of the cube
 
         for (ll resolution = 0; resolution < (1ll << n); resolution++){
             for (int j = 0; j < n; j++){
                 if ((resolution & (1ll << j)) != 0) continue; // jth bit already set
                 // jth bit not yet set
                 ll newResolution = resolution | (1ll << j);
-                set<set<int>> oldCircles = resolutionCube[resolution];
-                set<set<int>> newCircles = resolutionCube[newResolution];
-
-                set<set<int>> oldDiff = setComplement<set<int>>(oldCircles, newCircles);
-                set<set<int>> newDiff = setComplement<set<int>>(newCircles, oldCircles);
+                const CircleList &oldCircles = resolutionCube[resolution];
+                const CircleList &newCircles = resolutionCube[newResolution];
+                const CubeEdge &edge = edges[resolution * n + j];
+                auto &d = differentialMap[__builtin_popcountll(resolution)];
 
                 for (ll oldCirclesSubset = 0; oldCirclesSubset < (1ll << oldCircles.size()); oldCirclesSubset++){
                     ll oldIndex = circleStartingIndex[resolution] + oldCirclesSubset;
                     // (-) <-> 0, (+) <-> 1
-                    if (oldDiff.size() == 2){ // exactly 2 circles in the old resolution not in the new resolution
-                        // must be a merge
+                    ll newCircleStartIndex = circleStartingIndex[newResolution] + edge.moveSurvivors(oldCirclesSubset);
+                    // the circles that do not take part keep their status
+                    if (edge.merge){
+                        bool circleOneStatus = (oldCirclesSubset >> edge.oldSlots[0]) & 1;
+                        bool circleTwoStatus = (oldCirclesSubset >> edge.oldSlots[1]) & 1;
 
-                        bool circleOneStatus = ((oldCirclesSubset 
-                        & (1ll << resolutionCircleIndices[resolution][*(oldDiff.begin())])) != 0);
-                        bool circleTwoStatus = ((oldCirclesSubset 
-                        & (1ll << resolutionCircleIndices[resolution][*(++oldDiff.begin())])) != 0);
+                        vector<bool> newCircleStatuses = annularMerge(oldCircles[edge.oldSlots[0]], circleOneStatus,
+                        oldCircles[edge.oldSlots[1]], circleTwoStatus, hasPuncture);
 
-                        vector<bool> newCircleStatuses = annularMerge(*oldDiff.begin(), circleOneStatus,
-                        *(++oldDiff.begin()), circleTwoStatus, basis1, basis2);
-
-                        ll newCircleStartIndex = circleStartingIndex[newResolution];
-                        // update index for the new merged circle
                         for (bool newCircleStatus : newCircleStatuses){
                             ll newCircleIndex = newCircleStartIndex;
-                            if (newCircleStatus) newCircleIndex += (1ll << resolutionCircleIndices[newResolution][*newDiff.begin()]);
-                            for (ll oldCirclesIndex = 0; (ull) oldCirclesIndex < oldCircles.size(); oldCirclesIndex++){
-                                if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                                    if (newCircles.count(resolutionCirclesVector[resolution][oldCirclesIndex])){
-                                        newCircleIndex += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex]]);
-                                    }
-                                }
-                            }
-                            differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex] = 1;
+                            if (newCircleStatus) newCircleIndex += (1ll << edge.newSlots[0]);
+                            d[oldIndex][newCircleIndex] = 1;
                         }
                     }
-                    else if (oldDiff.size() == 1){ // must be a split
-                        ll newCircleStartIndex = circleStartingIndex[newResolution];
-                        for (ll oldCirclesIndex = 0; (ull) oldCirclesIndex < oldCircles.size(); oldCirclesIndex++){
-                            if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                                if (newCircles.count(resolutionCirclesVector[resolution][oldCirclesIndex])){
-                                    newCircleStartIndex += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex]]);
-                                }
-                            }
-                        }
+                    else if (edge.split){
+                        bool oldCircleStatus = (oldCirclesSubset >> edge.oldSlots[0]) & 1;
+                        vector<pair<bool, bool>> newCircleStatuses = annularSplit(oldCircles[edge.oldSlots[0]], oldCircleStatus,
+                        newCircles[edge.newSlots[0]], newCircles[edge.newSlots[1]], hasPuncture);
 
-                        bool oldCircleStatus = oldCirclesSubset & (1ll << resolutionCircleIndices[resolution][*oldDiff.begin()]);
-                        vector<pair<bool, bool>> newCircleStatuses = annularSplit(*oldDiff.begin(), oldCircleStatus,
-                        *newDiff.begin(), *(++newDiff.begin()), basis1, basis2);
-
-                        int newCircle1Index = resolutionCircleIndices[newResolution][*newDiff.begin()];
-                        int newCircle2Index = resolutionCircleIndices[newResolution][*(++newDiff.begin())];
                         for (pair<bool, bool> newCircleStatus : newCircleStatuses){
                             ll newCircleIndex = newCircleStartIndex;
-                            if (newCircleStatus.first) newCircleIndex += (1ll << newCircle1Index);
-                            if (newCircleStatus.second) newCircleIndex += (1ll << newCircle2Index);
-                            differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex] = 1;
+                            if (newCircleStatus.first) newCircleIndex += (1ll << edge.newSlots[0]);
+                            if (newCircleStatus.second) newCircleIndex += (1ll << edge.newSlots[1]);
+                            d[oldIndex][newCircleIndex] = 1;
                         }
                     }
                 }
@@ -706,10 +961,9 @@ namespace annular{
         basis2 = basis1;
         insertVector(basis2, specialMask);
 
-        vector<set<set<int>>> resolutionCube(1ll << n);
-        for (ll i = 0; i < (1ll << n); i++){
-            resolutionCube[i] = resolutionCircles(D, i);
-        }
+        CircleTable table(D);
+        ResolutionCube resolutionCube(table, n);
+        vector<bool> hasPuncture = punctures(table, basis1, basis2);
         
         vector<ll> ordering((1ll << n));
         vector<ll> circleStartingIndex((1ll << n));
@@ -731,26 +985,18 @@ namespace annular{
             differentialMap[i] = vector<vector<bool>>(basisStartCount[i], vector<bool>(basisStartCount[i+1]));
         }
 
-        vector<map<set<int>, ll>> resolutionCircleIndices(1ll << n);
-        vector<vector<set<int>>> resolutionCirclesVector(1ll << n);
-
-        for (ll resolution = 0; resolution < (1ll << n); resolution++){
-            ll count = 0;
-            for (auto x : resolutionCube[resolution]){
-                resolutionCircleIndices[resolution][x] = count++;
-                resolutionCirclesVector[resolution].push_back(x);
-            }
-        }
+        vector<CubeEdge> edges = cubeEdgeTable(table, resolutionCube, n);
+        // how the circles change along every edge of the cube
 
         vector<vector<int>> elementsToKeep(n+1); // for each degree, stores the column vectors to keep
         for (ll resolution = 0; resolution < (1ll << n); resolution++){
-            set<set<int>> circles = resolutionCube[resolution];
+            const CircleList &circles = resolutionCube[resolution];
             for (ll circlesSubset = 0; circlesSubset < (1ll << circles.size()); circlesSubset++){
                 ll index = circleStartingIndex[resolution] + circlesSubset;
                 ll count = 0;
                 ll circleIndex = 0;
                 for (auto circle : circles){
-                    if (containsPuncture(circle, basis1, basis2)){
+                    if (hasPuncture[circle]){
                         if ((1 << circleIndex) & circlesSubset) count++;
                         else count--;
                     }
@@ -765,62 +1011,39 @@ namespace annular{
                 if ((resolution & (1ll << j)) != 0) continue; // jth bit already set
                 // jth bit not yet set
                 ll newResolution = resolution | (1ll << j);
-                set<set<int>> oldCircles = resolutionCube[resolution];
-                set<set<int>> newCircles = resolutionCube[newResolution];
-
-                set<set<int>> oldDiff = setComplement<set<int>>(oldCircles, newCircles);
-                set<set<int>> newDiff = setComplement<set<int>>(newCircles, oldCircles);
+                const CircleList &oldCircles = resolutionCube[resolution];
+                const CircleList &newCircles = resolutionCube[newResolution];
+                const CubeEdge &edge = edges[resolution * n + j];
+                auto &d = differentialMap[__builtin_popcountll(resolution)];
 
                 for (ll oldCirclesSubset = 0; oldCirclesSubset < (1ll << oldCircles.size()); oldCirclesSubset++){
                     ll oldIndex = circleStartingIndex[resolution] + oldCirclesSubset;
                     // (-) <-> 0, (+) <-> 1
-                    if (oldDiff.size() == 2){ // exactly 2 circles in the old resolution not in the new resolution
-                        // must be a merge
+                    ll newCircleStartIndex = circleStartingIndex[newResolution] + edge.moveSurvivors(oldCirclesSubset);
+                    // the circles that do not take part keep their status
+                    if (edge.merge){
+                        bool circleOneStatus = (oldCirclesSubset >> edge.oldSlots[0]) & 1;
+                        bool circleTwoStatus = (oldCirclesSubset >> edge.oldSlots[1]) & 1;
 
-                        bool circleOneStatus = ((oldCirclesSubset 
-                        & (1ll << resolutionCircleIndices[resolution][*(oldDiff.begin())])) != 0);
-                        bool circleTwoStatus = ((oldCirclesSubset 
-                        & (1ll << resolutionCircleIndices[resolution][*(++oldDiff.begin())])) != 0);
+                        vector<bool> newCircleStatuses = annularMerge(oldCircles[edge.oldSlots[0]], circleOneStatus,
+                        oldCircles[edge.oldSlots[1]], circleTwoStatus, hasPuncture);
 
-                        vector<bool> newCircleStatuses = annularMerge(*oldDiff.begin(), circleOneStatus,
-                        *(++oldDiff.begin()), circleTwoStatus, basis1, basis2);
-
-                        ll newCircleStartIndex = circleStartingIndex[newResolution];
-                        // update index for the new merged circle
                         for (bool newCircleStatus : newCircleStatuses){
                             ll newCircleIndex = newCircleStartIndex;
-                            if (newCircleStatus) newCircleIndex += (1ll << resolutionCircleIndices[newResolution][*newDiff.begin()]);
-                            for (ll oldCirclesIndex = 0; (ull) oldCirclesIndex < oldCircles.size(); oldCirclesIndex++){
-                                if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                                    if (newCircles.count(resolutionCirclesVector[resolution][oldCirclesIndex])){
-                                        newCircleIndex += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex]]);
-                                    }
-                                }
-                            }
-                            differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex] = 1;
+                            if (newCircleStatus) newCircleIndex += (1ll << edge.newSlots[0]);
+                            d[oldIndex][newCircleIndex] = 1;
                         }
                     }
-                    else if (oldDiff.size() == 1){ // must be a split
-                        ll newCircleStartIndex = circleStartingIndex[newResolution];
-                        for (ll oldCirclesIndex = 0; (ull) oldCirclesIndex < oldCircles.size(); oldCirclesIndex++){
-                            if (oldCirclesSubset & (1ll << oldCirclesIndex)){
-                                if (newCircles.count(resolutionCirclesVector[resolution][oldCirclesIndex])){
-                                    newCircleStartIndex += (1ll << resolutionCircleIndices[newResolution][resolutionCirclesVector[resolution][oldCirclesIndex]]);
-                                }
-                            }
-                        }
-
-                        bool oldCircleStatus = oldCirclesSubset & (1ll << resolutionCircleIndices[resolution][*oldDiff.begin()]);
-                        vector<pair<bool, bool>> newCircleStatuses = annularSplit(*oldDiff.begin(), oldCircleStatus,
-                        *newDiff.begin(), *(++newDiff.begin()), basis1, basis2);
+                    else if (edge.split){
+                        bool oldCircleStatus = (oldCirclesSubset >> edge.oldSlots[0]) & 1;
+                        vector<pair<bool, bool>> newCircleStatuses = annularSplit(oldCircles[edge.oldSlots[0]], oldCircleStatus,
+                        newCircles[edge.newSlots[0]], newCircles[edge.newSlots[1]], hasPuncture);
 
-                        int newCircle1Index = resolutionCircleIndices[newResolution][*newDiff.begin()];
-                        int newCircle2Index = resolutionCircleIndices[newResolution][*(++newDiff.begin())];
                         for (pair<bool, bool> newCircleStatus : newCircleStatuses){
                             ll newCircleIndex = newCircleStartIndex;
-                            if (newCircleStatus.first) newCircleIndex += (1ll << newCircle1Index);
-                            if (newCircleStatus.second) newCircleIndex += (1ll << newCircle2Index);
-                            differentialMap[__builtin_popcountll(resolution)][oldIndex][newCircleIndex] = 1;
+                            if (newCircleStatus.first) newCircleIndex += (1ll << edge.newSlots[0]);
+                            if (newCircleStatus.second) newCircleIndex += (1ll << edge.newSlots[1]);
+                            d[oldIndex][newCircleIndex] = 1;
                         }
                     }
                 }
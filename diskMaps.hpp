@@ -0,0 +1,321 @@
+#ifndef DISK_MAPS
+#define DISK_MAPS
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include "differentialMaps.hpp"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+using ll = long long;
+using ull = unsigned long long;
+
+// out-of-core storage for differentials that do not fit in memory
+// spillDifferentialMaps writes d_i of a diagram to prefix.d<i>, one file per
+// degree, straight from the cube without ever building a dense Matrix. a file
+// is a header followed by one block per resolution of degree i, and a block
+// is the columns (generators) of that resolution in increasing order, each
+// given as its number of entries followed by its rows in increasing order:
+//     header:  magic, domain, codomain, entries, blocks      (5 x 8 bytes)
+//     block:   firstColumn, numColumns                        (2 x 8 bytes)
+//     column:  count, rows                                    ((1 + count) x 8 bytes)
+// so every field stays 8-byte aligned. consumers read the files front to
+// back, through mmap where it exists and buffered reads otherwise
+
+const ull sparseMapMagic = 0x3150414d53524150ull; // "PARSMAP1"
+const size_t diskBufferSize = 1 << 22; // bytes of stdio buffer per open file
+
+string sparseMapFile(const string &prefix, int degree){
+    return prefix + ".d" + to_string(degree);
+}
+
+class SparseMapHeader{
+    public:
+        ull magic = sparseMapMagic;
+        ll domain = 0; // generators of degree i, the columns
+        ll codomain = 0; // generators of degree i+1, the rows
+        ll entries = 0; // nonzero entries over all columns
+        ll blocks = 0;
+};
+
+class SparseMapWriter{
+    // appends column-sorted blocks to one degree's file; the header is written
+    // again with the final counts when the file is closed
+    private:
+        FILE *file = nullptr;
+        vector<char> buffer;
+        SparseMapHeader header;
+        ll nextColumn = 0;
+        ll blockColumns = 0;
+    public:
+        SparseMapWriter(const string &path, ll domain, ll codomain) : buffer(diskBufferSize){
+            file = fopen(path.c_str(), "wb");
+            if (!file){
+                cerr << "Could not open " << path << " for writing." << endl;
+                exit(1);
+            }
+            setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+            header.domain = domain;
+            header.codomain = codomain;
+            fwrite(&header, sizeof(header), 1, file);
+        }
+        SparseMapWriter(const SparseMapWriter&) = delete;
+        SparseMapWriter& operator=(const SparseMapWriter&) = delete;
+        ~SparseMapWriter(){
+            close();
+        }
+        void startBlock(ll firstColumn, ll numColumns){
+            // columns have to come in increasing order without gaps
+            assert(firstColumn == nextColumn);
+            ll block[2] = {firstColumn, numColumns};
+            fwrite(block, sizeof(block), 1, file);
+            header.blocks++;
+            blockColumns = numColumns;
+        }
+        void writeColumn(const ll *rows, ll count){ // rows sorted increasingly
+            assert(blockColumns > 0);
+            fwrite(&count, sizeof(count), 1, file);
+            fwrite(rows, sizeof(ll), count, file);
+            header.entries += count;
+            nextColumn++;
+            blockColumns--;
+        }
+        void close(){
+            if (!file) return;
+            assert(nextColumn == header.domain);
+            fflush(file);
+            fseek(file, 0, SEEK_SET);
+            fwrite(&header, sizeof(header), 1, file);
+            fclose(file);
+            file = nullptr;
+        }
+};
+
+class SparseMapReader{
+    // streams one degree's file front to back. with mmap the rows handed out
+    // point straight into the mapping, otherwise they are read into a buffer
+    private:
+        string path;
+        SparseMapHeader header;
+        FILE *file = nullptr;
+        vector<char> buffer;
+        vector<ll> rowBuffer;
+        const char *mapped = nullptr;
+        size_t mappedSize = 0, offset = 0;
+        void read(void *out, size_t bytes){
+            if (mapped){
+                if (offset + bytes > mappedSize){
+                    cerr << "Unexpected end of " << path << "." << endl;
+                    exit(1);
+                }
+                memcpy(out, mapped + offset, bytes);
+                offset += bytes;
+            }
+            else if (fread(out, 1, bytes, file) != bytes){
+                cerr << "Unexpected end of " << path << "." << endl;
+                exit(1);
+            }
+        }
+        const ll* readRows(ll count){
+            if (mapped){
+                if (offset + count * sizeof(ll) > mappedSize){
+                    cerr << "Unexpected end of " << path << "." << endl;
+                    exit(1);
+                }
+                const ll *ret = reinterpret_cast<const ll*>(mapped + offset);
+                offset += count * sizeof(ll);
+                return ret;
+            }
+            rowBuffer.resize(count);
+            read(rowBuffer.data(), count * sizeof(ll));
+            return rowBuffer.data();
+        }
+    public:
+        SparseMapReader(const string &filePath) : path(filePath){
+#ifndef _WIN32
+            int fd = open(path.c_str(), O_RDONLY);
+            struct stat info;
+            if (fd != -1 && fstat(fd, &info) == 0 && info.st_size > 0){
+                void *ret = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (ret != MAP_FAILED){
+                    mapped = static_cast<const char*>(ret);
+                    mappedSize = info.st_size;
+                    madvise(ret, mappedSize, MADV_SEQUENTIAL);
+                }
+            }
+            if (fd != -1) ::close(fd);
+#endif
+            if (!mapped){
+                file = fopen(path.c_str(), "rb");
+                if (!file){
+                    cerr << "Could not open " << path << "." << endl;
+                    exit(1);
+                }
+                buffer.resize(diskBufferSize);
+                setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+            }
+            read(&header, sizeof(header));
+            if (header.magic != sparseMapMagic){
+                cerr << path << " is not a sparse map file." << endl;
+                exit(1);
+            }
+        }
+        SparseMapReader(const SparseMapReader&) = delete;
+        SparseMapReader& operator=(const SparseMapReader&) = delete;
+        ~SparseMapReader(){
+#ifndef _WIN32
+            if (mapped) munmap(const_cast<char*>(mapped), mappedSize);
+#endif
+            if (file) fclose(file);
+        }
+        const SparseMapHeader& info() const{
+            return header;
+        }
+        template<class F> void forEachColumn(F f){
+            // f(column, rows, count) for every column in order; one pass per reader
+            for (ll b = 0; b < header.blocks; b++){
+                ll block[2];
+                read(block, sizeof(block));
+                for (ll column = block[0]; column < block[0] + block[1]; column++){
+                    ll count;
+                    read(&count, sizeof(count));
+                    f(column, readRows(count), count);
+                }
+            }
+        }
+};
+
+vector<ll> spillDifferentialMaps(PD D, bool reducedHomology, const string &prefix){
+    // writes d_0, ..., d_(n-1) to prefix.d0, ..., prefix.d(n-1) with the same
+    // generator numbering as regularDifferentialMaps and reducedDifferentialMaps,
+    // and returns the chain group dimensions. only the circles of the cube are
+    // kept in memory; edges are worked out one resolution at a time
+    int n = D.size();
+    int marked = reducedHomology ? 1 : 0;
+    CircleTable table(D);
+    ResolutionCube resolutionCube(table, n);
+
+    vector<ll> circleStartingIndex(1ll << n);
+    vector<ll> basisStartCount(n+1, 0);
+    for (ll i = 0; i < (1ll << n); i++){
+        circleStartingIndex[i] = basisStartCount[__builtin_popcountll(i)];
+        basisStartCount[__builtin_popcountll(i)] += (1ll << (resolutionCube[i].size() - marked));
+    }
+
+    vector<unique_ptr<SparseMapWriter>> writers(n);
+    for (int i = 0; i < n; i++){
+        writers[i].reset(new SparseMapWriter(sparseMapFile(prefix, i), basisStartCount[i], basisStartCount[i+1]));
+    }
+
+    CirclePositions oldPositions(table.size()), newPositions(table.size());
+    vector<CubeEdge> edges(n);
+    vector<ll> newStart(n);
+    vector<ll> rows;
+    for (ll resolution = 0; resolution < (1ll << n); resolution++){
+        int degree = __builtin_popcountll(resolution);
+        if (degree == n) continue; // the last chain group has no outgoing map
+        const CircleList &oldCircles = resolutionCube[resolution];
+        oldPositions.load(oldCircles);
+        int numEdges = 0;
+        for (int j = 0; j < n; j++){
+            if (resolution & (1ll << j)) continue;
+            ll newResolution = resolution | (1ll << j);
+            newPositions.load(resolutionCube[newResolution]);
+            edges[numEdges] = cubeEdge(oldCircles, resolutionCube[newResolution], oldPositions, newPositions);
+            newStart[numEdges++] = circleStartingIndex[newResolution];
+        }
+        ll generators = 1ll << (oldCircles.size() - marked);
+        writers[degree]->startBlock(circleStartingIndex[resolution], generators);
+        for (ll subset = 0; subset < generators; subset++){
+            rows.clear();
+            for (int e = 0; e < numEdges; e++){
+                ll images[2];
+                int count = differentialImages(edges[e], subset, reducedHomology, images);
+                for (int k = 0; k < count; k++) rows.push_back(newStart[e] + images[k]);
+            }
+            sort(rows.begin(), rows.end());
+            rows.erase(unique(rows.begin(), rows.end()), rows.end());
+            writers[degree]->writeColumn(rows.data(), rows.size());
+        }
+    }
+    for (int i = n; remove(sparseMapFile(prefix, i).c_str()) == 0; i++); // left over from a larger diagram
+    return basisStartCount;
+}
+
+SparseMapHeader sparseMapInfo(const string &prefix, int degree){
+    SparseMapReader reader(sparseMapFile(prefix, degree));
+    return reader.info();
+}
+
+int spilledMapCount(const string &prefix){
+    // number of consecutive degree files present under prefix
+    int n = 0;
+    while (true){
+        FILE *file = fopen(sparseMapFile(prefix, n).c_str(), "rb");
+        if (!file) return n;
+        fclose(file);
+        n++;
+    }
+}
+
+ll physicalMemoryBytes(){
+    // memory installed in this machine, -1 where it cannot be asked for
+#ifndef _WIN32
+    long pages = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 && pageSize > 0) return (ll)pages * pageSize;
+#endif
+    return -1;
+}
+
+Matrix readMatrix(const string &prefix, int degree){
+    // the dense form of one spilled map, for code that still wants a Matrix
+    SparseMapReader reader(sparseMapFile(prefix, degree));
+    Matrix ret(reader.info().domain, reader.info().codomain);
+    reader.forEachColumn([&](ll column, const ll *rows, ll count){
+        for (ll k = 0; k < count; k++) ret[column][rows[k]] = 1;
+    });
+    return ret;
+}
+
+template<class Reader> ll columnRank(Reader &&reader){
+    // rank over F_2 from one sequential pass over the columns of anything with
+    // forEachColumn. columns are reduced against the stored pivots by their
+    // largest row, so memory grows with the reduced columns kept rather than
+    // with the map
+    vector<vector<ll>> pivotColumn; // reduced columns, indexed through pivotOf
+    unordered_map<ll, int> pivotOf; // largest row -> its reduced column
+    vector<ll> column, merged;
+    reader.forEachColumn([&](ll, const ll *rows, ll count){
+        column.assign(rows, rows + count);
+        while (!column.empty()){
+            auto it = pivotOf.find(column.back());
+            if (it == pivotOf.end()) break;
+            const vector<ll> &other = pivotColumn[it->second];
+            merged.clear();
+            set_symmetric_difference(column.begin(), column.end(), other.begin(), other.end(), back_inserter(merged));
+            swap(column, merged);
+        }
+        if (!column.empty()){
+            pivotOf[column.back()] = pivotColumn.size();
+            pivotColumn.push_back(column);
+        }
+    });
+    return pivotColumn.size();
+}
+
+ll streamedRank(const string &prefix, int degree){
+    // rank of d_degree
+    return columnRank(SparseMapReader(sparseMapFile(prefix, degree)));
+}
+
+#endif
@@ -1,5 +1,5 @@
 // program to find distances using planar diagram notation directly from input.txt
-// should modify N to be the maximum matrix size + 10 to be safe
+// vectors are packed into as many 64-bit words as the largest matrix needs
 
 // for regular reduced homology, input format should contain 4*n space separated integers
 // each referring to a strand index in a crossing
@@ -13,12 +13,30 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <set>
 #include <cassert>
-#include <bitset>
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <chrono>
 
 #include "differentialMaps.hpp"
 #include "matrices.hpp"
 #include "sl3Calculation.hpp"
+#include "bitVectors.hpp"
+#include "searchState.hpp"
+#include "weightEnumerator.hpp"
+#include "diskMaps.hpp"
+#include "binaryMaps.hpp"
+#include "batchInput.hpp"
+#include "jobScheduler.hpp"
+#include "resultCache.hpp"
+#include "localServer.hpp"
+#include "simplifyPD.hpp"
+#include "tangleComplex.hpp"
+#include "mappingCone.hpp"
+#include "factorPD.hpp"
+#include "mirrorPD.hpp"
 
 using namespace std;
 
@@ -26,206 +44,1159 @@ using namespace std;
 #define all(a) (a).begin(), (a).end()
 #define pb push_back
 
-const int N = 401;
 const int timeLimit = 30; // seconds to finish calculation at one degree
+const bool searchByBlocks = 1; // split the complex into graded blocks before searching
+const bool outputBlockDistances = 0; // print the per-block results the combined distances come from
 
 using ll = long long;
 using vi = vector<int>;
 using vll = vector<ll>;
 using pll = pair<ll, ll>;
 using ld = long double;
-using num = bitset<N>;
-using vn = vector<num>;
 
 #define forn(i, n) for (int i = 0; i < int(n); i++)
 
 const ll INF = 1e18;
 
-num nextPerm(num v){
-    num ret = v;
-    ll count = 0;
-    forn(i, N-1){
-        if (v[i]){
-            if (!v[i+1]){
-                ret[i] = 0;
-                ret[i+1] = 1;
-                return ret;
-            }
-            else{
-                ret[i] = 0;
-                ret[count++] = 1;
-            }
-        }
-    }
-    ret = num(0);
-    return ret;
-}
-
-// inline ll next_bit_perm(ll v) { // doesn't work for big v
-//     ll t = v | (v - 1);
-//     return (t + 1) | (((~t & -~t) - 1) >> (__builtin_ctzll(v) + 1));
-// }
-
-void insertVector(ll &rank, vn &basis, num mask) {
-	for (ll i = 0; i < basis.size(); i++) {
-		if (!(mask[i])) continue;
-		if (basis[i] == num(0)) {
-			basis[i] = mask;		
+template<class num> void insertVector(ll &rank, vector<num> &basis, num mask) {
+    // basis[i] is either empty or has i as its lowest set bit, so xoring it
+    // in only touches bits after i
+	for (int i = mask.findFirst(); i < sz(basis); i = mask.findNext(i)) {
+		if (basis[i].none()) {
+			basis[i] = mask;
             rank++;
+            return;
 		}
 		mask ^= basis[i];
 	}
 }
 
-bool isLinearlyIndependent(const vn &basis, num mask){
-    for (ll i = 0; i < basis.size(); i++){
-        if (!(mask[i])) continue;
-        if (basis[i] == num(0)) return 1;
+template<class num> bool isLinearlyIndependent(const vector<num> &basis, num mask){
+    for (int i = mask.findFirst(); i < sz(basis); i = mask.findNext(i)){
+        if (basis[i].none()) return 1;
         mask ^= basis[i];
     }
     return 0;
 }
 
-int minDist(vn oldMap, vn newMap, bool outputLengths, bool outputHomologyDimensions, bool outputCount){
-    vn basis1(N), basis2(N);
+template<class num> vector<num> kernelBasis(const vector<num> &vectors){
+    // basis of the subsets of vectors that sum to zero, found by eliminating
+    // the vectors while tracking which of them were combined
+    vector<num> pivots(num().size()), combinations(num().size());
+    vector<num> ret;
+    forn(j, vectors.size()){
+        num v = vectors[j], combination;
+        combination.set(j);
+        int i = v.findFirst();
+        for (; i < sz(pivots); i = v.findNext(i)){
+            if (pivots[i].none()) break;
+            v ^= pivots[i];
+            combination ^= combinations[i];
+        }
+        if (i < sz(pivots)){
+            pivots[i] = v;
+            combinations[i] = combination;
+        }
+        else ret.pb(combination);
+    }
+    return ret;
+}
+
+template<class num> vector<num> independentBasis(const vector<num> &vectors){
+    vector<num> basis(num().size()), ret;
+    ll rank = 0;
+    for (auto &x : vectors) insertVector(rank, basis, x);
+    for (auto &x : basis) if (!x.none()) ret.pb(x);
+    return ret;
+}
+
+template<class num> void outputWeightDistributions(const vector<num> &oldMap, const vector<num> &newMap, const vector<num> &oldTranspose, const vector<num> &newTranspose, const string &label){
+    // weight distributions of the cycles ker(newMap) and of the logical
+    // operators, the cycles outside the image of oldMap; the dual of each
+    // code comes from the transposes, ker(newMap)^perp = span(newTranspose)
+    // and span(oldMap)^perp = ker(oldTranspose)
+    int n = newMap.size();
+    vector<WideInt> cycles = codeWeightDistribution(kernelBasis(newMap), independentBasis(newTranspose), n);
+    vector<WideInt> boundaries = codeWeightDistribution(independentBasis(oldMap), kernelBasis(oldTranspose), n);
+    cout << label << " cycles:";
+    if (cycles.empty()) cout << " too large to enumerate";
+    for (auto &x : cycles) cout << ' ' << x.toString();
+    cout << endl;
+    cout << label << " logical:";
+    if (cycles.empty() || boundaries.empty()) cout << " too large to enumerate";
+    else forn(w, n+1){
+        WideInt logical = cycles[w];
+        logical -= boundaries[w];
+        cout << ' ' << logical.toString();
+    }
+    cout << endl;
+}
+
+template<class num> ull mapHash(const vector<num> &vectors, ull h = 1469598103934665603ull){
+    // FNV-1a over the packed words, used to tell checkpoints of different complexes apart
+    for (auto &x : vectors){
+        forn(i, x.words()){
+            h ^= x.word(i);
+            h *= 1099511628211ull;
+        }
+    }
+    h ^= vectors.size();
+    h *= 1099511628211ull;
+    return h;
+}
+
+template<class num> string searchKey(const string &direction, int degree, bool countAll, const vector<num> &oldMap, const vector<num> &newMap){
+    ostringstream ss;
+    ss << direction << '-' << degree << '-' << (countAll ? "count" : "distance") << '-' << hex << mapHash(newMap, mapHash(oldMap));
+    return ss.str();
+}
+
+class DegreeResult{
+    public:
+        ll dimension = 0; // number of generators in this degree
+        ll rank = 0; // rank of the outgoing map
+        ll homologyDimension = 0;
+        ll distance = 0; // minimum weight of a cycle that is not a boundary, -lowerBound if the search timed out
+        ll count = 0; // number of such cycles at that weight, only complete when counting was requested
+        bool timedOut = 0;
+        ll lowerBound = 0, upperBound = 0; // the distance lies in between, both equal to it once the search finished
+};
+
+class ComplexResults{
+    public:
+        vector<DegreeResult> cycles, cocycles; // per degree, for the complex and its transpose
+};
+
+template<class num> DegreeResult analyzeDegree(const vector<num> &oldMap, const vector<num> &newMap, bool searchDistance, bool countAll, const string &key = "",
+const vector<vi> &symmetries = {}){
+    // symmetries, if given, is a group of permutations of the generators of
+    // this degree that commute with the differentials
+    // eliminates both maps once and runs at most one enumeration, which gives
+    // the minimum weight and, if countAll is set, its multiplicity
+    DegreeResult ret;
+    vector<num> basis1(num().size()), basis2(num().size());
     ll rank1, rank2;
     rank1 = rank2 = 0;
-    for (auto x : oldMap) insertVector(rank1, basis1, x);
-    for (auto x : newMap) insertVector(rank2, basis2, x);
+    for (auto &x : oldMap) insertVector(rank1, basis1, x);
+    for (auto &x : newMap) insertVector(rank2, basis2, x);
     // cerr << "Dimension: " << newMap.size() << ", Rank: " << rank2 << endl;
-    if (outputLengths){
-        return newMap.size();
+    ret.dimension = newMap.size();
+    ret.rank = rank2;
+    ret.homologyDimension = newMap.size() - rank2 - rank1;
+    if (!searchDistance || !ret.homologyDimension){
+        return ret;
     }
-    if (outputHomologyDimensions){
-        return newMap.size() - rank2 - rank1;
+    const vector<num> &vectors = newMap;
+    ll n = vectors.size();
+
+    // enumerating column subsets costs about sum_k k * C(n, k) up to the
+    // distance, which is at most the weight of the lightest homology
+    // representative; enumerating the cycle space costs 2^dim ker(d)
+    vector<num> kernel = kernelBasis(vectors);
+    vector<num> imageBasis, representatives;
+    ll imageRank = 0;
+    vector<num> quotientBasis = basis1;
+    for (auto &x : basis1) if (!x.none()) imageBasis.pb(x);
+    for (auto &x : kernel){
+        ll before = imageRank;
+        insertVector(imageRank, quotientBasis, x);
+        if (imageRank != before) representatives.pb(x);
     }
-    if (rank1 == newMap.size() - rank2){
-        return 0;
+    assert(sz(representatives) == ret.homologyDimension);
+    ll upperBound = n; // every representative is a cycle outside the image
+    for (auto &x : representatives) upperBound = min(upperBound, (ll)x.count());
+    ld columnCost = 0, binomial = 1;
+    for (int k = 1; k <= upperBound && columnCost < 1e30; k++){
+        binomial = binomial * (n - k + 1) / k;
+        columnCost += binomial * k;
     }
-    vn vectors = newMap;
-    ll n = vectors.size();
-    ld tic = clock();
+    ld kernelCost = pow((ld)2, (ld)sz(kernel));
+    bool useKernel = sz(kernel) < 63 && kernelCost <= columnCost;
 
-    ll count = 0;
+    // the three enumerations keep different cursors, so each gets its own key
+    string stateKey = key + (useKernel ? "-kernel" : sz(symmetries) > 1 ? "-symmetric" : "");
+    SearchState &state = searchStates[stateKey];
+    state.key = stateKey;
+    auto finish = [&](){
+        ret.distance = ret.lowerBound = ret.upperBound = state.weight;
+        ret.count = state.count;
+        dropSearchState(stateKey);
+        return ret;
+    };
+    auto stopped = [&](ll lower, ll upper){
+        // out of time with every weight below lower ruled out and a cycle of weight upper known
+        ret.timedOut = 1;
+        ret.lowerBound = lower;
+        ret.upperBound = upper;
+        ret.distance = ret.count = -lower;
+        if (!useCheckpoints) dropSearchState(stateKey); // nothing will resume it
+        return ret;
+    };
+    SearchProgress progress(state, timeLimit);
 
-    for (int k = 1; k <= n; ++k) {
-        num w(0);
-        forn(i, k) w[i] = 1;
-        for (; !w[n]; w = nextPerm(w)) {
-            ld tac = clock();
-            if ((tac - tic) / CLOCKS_PER_SEC > timeLimit){
-                return -k;
+    if (useKernel){
+        // Gray-code walk over every cycle, representatives first so a cycle is
+        // outside the image exactly when one of the low coordinates is set
+        vector<num> generators = representatives;
+        for (auto &x : imageBasis) generators.pb(x);
+        ull representativeMask = (1ull << sz(representatives)) - 1;
+        ull total = 1ull << sz(generators);
+        ull start = 1;
+        if (sz(state.cursor)) start = state.cursor[0];
+        else{
+            state.weight = n + 1;
+            state.count = 0;
+        }
+        num cycle;
+        ull gray = (start - 1) ^ ((start - 1) >> 1);
+        forn(i, sz(generators)) if (gray >> i & 1) cycle ^= generators[i];
+        for (ull g = start; g < total; g++){
+            SearchEvent event = progress.poll([&]{ return "best weight " + to_string(state.weight); });
+            if (event != keepGoing){
+                state.cursor = {g};
+                saveSearchStates();
+                if (event == stopNow){
+                    cerr << "Interrupted, search state saved to " << checkpointFile << endl;
+                    exit(130);
+                }
+                if (event == outOfTime){
+                    // the walk finds cycles in no particular order of weight, so
+                    // nothing is ruled out yet; the lightest so far bounds it above
+                    return stopped(1, min(upperBound, (ll)state.weight));
+                }
+            }
+            int bit = __builtin_ctzll(g);
+            cycle ^= generators[bit];
+            gray ^= (1ull << bit);
+            if (!(gray & representativeMask)) continue;
+            ll weight = cycle.count();
+            if (weight < state.weight){
+                state.weight = weight;
+                state.count = 0;
+            }
+            if (weight == state.weight) state.count++;
+        }
+        return finish();
+    }
+
+    if (sz(symmetries) > 1){
+        // orbit representatives only. every orbit of subsets has a member whose
+        // lowest column is the lowest point of its own orbit, so subsets are
+        // generated in lexicographic order with the first column restricted to
+        // those points. columns are renumbered so each orbit of points is
+        // contiguous, which spreads the allowed first columns out instead of
+        // bunching them at the front where most subsets start. in count mode
+        // each logical operator found is reduced to the smallest member of its
+        // orbit and the orbit's size is counted once; those orbits aren't
+        // saved, so a checkpoint in count mode restarts the current weight
+        vi order, position(n, -1); // order[new index] = column, position is its inverse
+        vector<bool> lowestInOrbit(n, 0);
+        forn(j, n){
+            if (position[j] != -1) continue;
+            set<int> orbit;
+            for (auto &g : symmetries) orbit.insert(g[j]);
+            lowestInOrbit[sz(order)] = 1;
+            for (int x : orbit){
+                position[x] = sz(order);
+                order.pb(x);
             }
-            num mask = 0;
-            bool good = 0;
-            forn(j, n-14){
-                if (w[j]){
-                    mask ^= vectors[j+14];
-                    good = 1;
+        }
+        vector<vi> renumbered;
+        for (auto &g : symmetries){
+            vi image(n);
+            forn(j, n) image[j] = position[g[order[j]]];
+            renumbered.pb(image);
+        }
+        auto nextLowest = [&](int from){
+            while (from < n && !lowestInOrbit[from]) from++;
+            return from;
+        };
+        set<vi> orbitsFound;
+        for (int k = state.weight; k <= n; ++k) {
+            vi c(k);
+            if (k == state.weight && sz(state.cursor) == k){
+                forn(i, k) c[i] = state.cursor[i];
+            }
+            else{
+                state.weight = k;
+                state.count = 0;
+                c[0] = nextLowest(0);
+                for (int i = 1; i < k; i++) c[i] = c[i-1] + 1;
+            }
+            orbitsFound.clear();
+            while (c[k-1] < n){
+                SearchEvent event = progress.poll([&]{ return "weight " + to_string(k) + ", up to symmetry"; });
+                if (event != keepGoing){
+                    if (countAll) state.cursor.clear();
+                    else state.cursor.assign(c.begin(), c.end());
+                    saveSearchStates();
+                    if (event == stopNow){
+                        cerr << "Interrupted at weight " << k << ", search state saved to " << checkpointFile << endl;
+                        exit(130);
+                    }
+                    if (event == outOfTime) return stopped(k, upperBound);
+                }
+                num mask;
+                forn(i, k) mask ^= vectors[order[c[i]]];
+                if (mask.none()){
+                    num w;
+                    forn(i, k) w.set(order[c[i]]);
+                    if (isLinearlyIndependent(basis1, w)){
+                        if (!countAll){
+                            state.count = 1;
+                            return finish();
+                        }
+                        set<vi> orbit;
+                        for (auto &g : renumbered){
+                            vi image(k);
+                            forn(i, k) image[i] = g[c[i]];
+                            sort(all(image));
+                            orbit.insert(image);
+                        }
+                        if (orbitsFound.insert(*orbit.begin()).second) state.count += sz(orbit);
+                    }
                 }
+                // next subset in lexicographic order, keeping the first column lowest in its orbit
+                int t = k - 1;
+                while (t >= 0 && c[t] == n - k + t) t--;
+                if (t < 0) break;
+                c[t]++;
+                if (!t) c[0] = nextLowest(c[0]);
+                for (int i = t + 1; i < k; i++) c[i] = c[i-1] + 1;
             }
-            if (!good) break;
-            if (mask == num(0)){
-                num newW;
-                forn(i, N){
-                    if (w[i]) newW[i+14] = 1;
+            if (state.count) return finish();
+        }
+        assert(0); // shouldn't reach here
+    }
+
+    auto checkpoint = [&](const num &w){
+        state.cursor.resize(w.words());
+        forn(i, w.words()) state.cursor[i] = w.word(i);
+        saveSearchStates();
+    };
+
+    for (int k = state.weight; k <= n; ++k) {
+        num w;
+        if (k == state.weight && sz(state.cursor) == w.words()){
+            forn(i, w.words()) w.word(i) = state.cursor[i];
+        }
+        else{
+            w.setPrefix(k);
+            state.weight = k;
+            state.count = 0;
+        }
+        for (; !w[n]; w = nextPerm(w)) {
+            SearchEvent event = progress.poll([&]{ return "weight " + to_string(k); });
+            if (event != keepGoing){
+                checkpoint(w);
+                if (event == stopNow){
+                    cerr << "Interrupted at weight " << k << ", search state saved to " << checkpointFile << endl;
+                    exit(130);
                 }
-                if (isLinearlyIndependent(basis1, newW)){
-                    if (outputCount) count++;
-                    else return k;
+                if (event == outOfTime) return stopped(k, upperBound);
+            }
+            num mask;
+            for (int j = w.findFirst(); j < n; j = w.findNext(j)){
+                mask ^= vectors[j];
+            }
+            if (mask.none()){
+                if (isLinearlyIndependent(basis1, w)){
+                    state.count++;
+                    if (!countAll) return finish();
                 }
             }
         }
-        if (count && outputCount) return count;
+        if (state.count) return finish();
     }
     
     assert(0); // shouldn't reach here
-    return 0;
+    return ret;
 }
 
-void getAllDistances(vector<Matrix> &maps, bool outputLengths, bool outputHomologyDimension, bool outputDistance, bool outputCounts){
-    ll maxMatrixSize = 0;
-    forn(i, maps.size()){
-        maxMatrixSize = max(maxMatrixSize, (ll)(maps[i].r));
-    }
-    if (maxMatrixSize + 5 > N){
-        cerr << "N should be at least " << maxMatrixSize + 5 << endl;
-        exit(1);
+template<class num> vector<num> packColumns(Matrix &mat){
+    // mat is stored as a vector of column vectors
+    vector<num> ret(mat.size());
+    forn(j, mat.size()){
+        forn(k, mat[j].size()){
+            if (mat[j][k]) ret[j].set(k);
+        }
     }
+    return ret;
+}
 
-    ll n = maps.size();
-    // forn(i, n) outputMatrix(maps[i]);
-    forn(i, n-1){
-        if (maps[i].r == 0 || maps[i].c == 0 || maps[i+1].r == 0 || maps[i+1].c == 0) continue;
-        Matrix mat = matrixMult(maps[i], maps[i+1]);
-        // outputMatrix(mat);
-        for (auto x : mat.mat){
-            for (auto y : x){
-                assert(!y);
+template<class num> vector<num> readPackedColumns(const string &prefix, int degree){
+    // the packed columns of a map spilled by spillDifferentialMaps, read in one pass
+    SparseMapReader reader(sparseMapFile(prefix, degree));
+    vector<num> ret(reader.info().domain);
+    reader.forEachColumn([&](ll column, const ll *rows, ll count){
+        forn(k, count) ret[column].set(rows[k]);
+    });
+    return ret;
+}
+
+template<class num> vector<num> readPackedColumns(const BinaryMap &map){
+    // the packed columns of one map of a binary maps file
+    vector<num> ret(map.entry.domain);
+    map.forEachColumn([&](ll column, const ll *rows, ll count){
+        forn(k, count) ret[column].set(rows[k]);
+    });
+    return ret;
+}
+
+template<class num> vector<vi> complexBlocks(const vector<vector<num>> &matrices){
+    // the differential preserves the quantum grading (and the annular grading
+    // for annular inputs), so the complex is a direct sum of subcomplexes.
+    // generators are not homogeneous in q in Audoux's basis, so instead of
+    // reading gradings off the cube this takes the connected components of
+    // the differential's support, which refine every grading the maps respect.
+    // returns blockOf[i][j], the block of generator j in degree i, for matrices
+    // laid out as in analyzeComplex
+    int n = sz(matrices) - 2;
+    vi offset(n+2, 0);
+    forn(i, n+1) offset[i+1] = offset[i] + sz(matrices[i+1]);
+    vi parent(offset[n+1]);
+    forn(i, sz(parent)) parent[i] = i;
+    function<int(int)> find = [&](int x){
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    };
+    forn(i, n){
+        forn(j, sz(matrices[i+1])){
+            const num &column = matrices[i+1][j];
+            for (int k = column.findFirst(); k < column.size(); k = column.findNext(k)){
+                parent[find(offset[i] + j)] = find(offset[i+1] + k);
             }
         }
     }
-    vector<vn> matrices(n+2, vn(0));
-    forn(i, n){
-        matrices[i+1] = vn(maps[i].size(), num(0));
-        forn(j, maps[i].size()){
-            forn(k, maps[i][j].size())
-                matrices[i+1][j][k] = maps[i][j][k];
+    map<int, int> blockIndex;
+    vector<vi> blockOf(n+1);
+    forn(i, n+1){
+        forn(j, sz(matrices[i+1])){
+            int root = find(offset[i] + j);
+            if (!blockIndex.count(root)){
+                int next = sz(blockIndex);
+                blockIndex[root] = next;
+            }
+            blockOf[i].pb(blockIndex[root]);
         }
     }
-    if (maps[n-1].size() == 0) matrices[n+1] = {};
-    else matrices[n+1] = vn(maps[n-1][0].size());
-    vector<vn> matrixTransposes(n+2, vn(0));
-    forn(i, n){
-        maps[i] = takeTranspose(Matrix(maps[i]));
+    return blockOf;
+}
+
+template<class F> void withPackedWidth(ll bits, F f){
+    // calls f with a default PackedBits of the narrowest width that holds bits
+    int words = packedWordCount(bits);
+    if (words == 1) f(PackedBits<1>());
+    else if (words == 2) f(PackedBits<2>());
+    else if (words == 4) f(PackedBits<4>());
+    else if (words == 8) f(PackedBits<8>());
+    else if (words == 16) f(PackedBits<16>());
+    else{
+        dynamicWords = (bits + 63) / 64;
+        f(PackedBits<0>());
     }
+}
 
-    if (maps[0].size() == 0) matrixTransposes[0] = vn(0);
-    else matrixTransposes[0] = vn(maps[0][0].size());
-    forn(i, n){
-        matrixTransposes[i+1] = vn(maps[i].size(), num(0));
-        forn(j, maps[i].size()){
-            forn(k, maps[i][j].size())
-                matrixTransposes[i+1][j][k] = maps[i][j][k];
+template<class blockNum, class num> vector<blockNum> restrictToBlock(const vector<num> &vectors, const vi &domain, const vi &localIndex){
+    // keeps the vectors indexed by domain and renumbers their coordinates
+    // with localIndex, which is -1 outside the block, repacked at the
+    // block's own width
+    vector<blockNum> ret(sz(domain));
+    forn(j, sz(domain)){
+        const num &v = vectors[domain[j]];
+        for (int k = v.findFirst(); k < v.size(); k = v.findNext(k)){
+            assert(localIndex[k] != -1);
+            ret[j].set(localIndex[k]);
+        }
+    }
+    return ret;
+}
+
+template<class num> DegreeResult analyzeDegreeByBlocks(const vector<num> &oldMap, const vector<num> &newMap, int oldDegree, int degree, int newDegree,
+const vector<vi> &blockOf, int numBlocks, bool searchDistance, bool countAll, const string &direction, ostringstream &certificate,
+const vector<vi> &symmetries = {}){
+    // runs analyzeDegree on every block separately. a cycle splits into one
+    // cycle per block and is a boundary exactly when every piece is, so a
+    // minimum weight logical operator lives in a single block: the distance
+    // is the minimum over blocks and the count sums the blocks attaining it
+    int n = sz(blockOf) - 1;
+    auto membersOf = [&](int deg){
+        vector<vi> members(numBlocks);
+        if (deg >= 0 && deg <= n) forn(j, sz(blockOf[deg])) members[blockOf[deg][j]].pb(j);
+        return members;
+    };
+    auto localIndices = [&](int deg){
+        vi local;
+        if (deg >= 0 && deg <= n){
+            local.assign(sz(blockOf[deg]), -1);
+            vi seen(numBlocks, 0);
+            forn(j, sz(blockOf[deg])) local[j] = seen[blockOf[deg][j]]++;
+        }
+        return local;
+    };
+    vector<vi> oldMembers = membersOf(oldDegree), members = membersOf(degree), newMembers = membersOf(newDegree);
+    vi local = localIndices(degree), newLocal = localIndices(newDegree);
+
+    DegreeResult ret;
+    bool anyStopped = 0;
+    ll stoppedLower = 0, stoppedUpper = 0; // smallest bounds over the blocks whose search stopped
+    ll best = 0; // smallest distance over the blocks that finished, 0 if none did
+    vector<DegreeResult> blockResults(numBlocks);
+    forn(b, numBlocks){
+        if (members[b].empty()) continue;
+        vector<vi> blockSymmetries; // the symmetries that carry this block to itself, renumbered
+        for (auto &g : symmetries){
+            bool keepsBlock = 1;
+            for (int j : members[b]) if (blockOf[degree][g[j]] != b) keepsBlock = 0;
+            if (!keepsBlock) continue;
+            vi localImage(sz(members[b]));
+            forn(j, sz(members[b])) localImage[j] = local[g[members[b][j]]];
+            blockSymmetries.pb(localImage);
+        }
+        DegreeResult &result = blockResults[b];
+        // the block's vectors have coordinates in this degree and the next,
+        // so it is searched at the narrowest width that holds those and not
+        // at the complex's. the complex may itself be at the dynamic width,
+        // so dynamicWords is put back for the vectors still to be made here
+        int complexWords = dynamicWords;
+        withPackedWidth(max(sz(members[b]), sz(newMembers[b])) + 1, [&](auto bits){
+            using blockNum = decltype(bits);
+            vector<blockNum> blockOld = restrictToBlock<blockNum>(oldMap, oldMembers[b], local);
+            vector<blockNum> blockNew = restrictToBlock<blockNum>(newMap, members[b], newLocal);
+            result = analyzeDegree(blockOld, blockNew, searchDistance, countAll,
+            searchKey(direction + "-block" + to_string(b), degree, countAll, blockOld, blockNew), blockSymmetries);
+        });
+        dynamicWords = complexWords;
+        ret.dimension += result.dimension;
+        ret.rank += result.rank;
+        ret.homologyDimension += result.homologyDimension;
+        if (!result.homologyDimension || !searchDistance) continue;
+        if (result.timedOut){
+            stoppedLower = anyStopped ? min(stoppedLower, result.lowerBound) : result.lowerBound;
+            stoppedUpper = anyStopped ? min(stoppedUpper, result.upperBound) : result.upperBound;
+            anyStopped = 1;
+        }
+        else if (!best || result.distance < best) best = result.distance;
+        certificate << direction << " degree " << degree << ", block " << b << ": " << result.dimension
+        << " generators, homology " << result.homologyDimension << ", distance " << result.distance << ", count " << result.count << endl;
+    }
+    if (!searchDistance || !ret.homologyDimension) return ret;
+    if (anyStopped && (!best || stoppedLower <= best)){
+        // a stopped block might still hold something lighter than (or as light as) best
+        ret.timedOut = 1;
+        ret.lowerBound = best ? min(best, stoppedLower) : stoppedLower;
+        ret.upperBound = best ? min(best, stoppedUpper) : stoppedUpper;
+        ret.distance = ret.count = -ret.lowerBound;
+        return ret;
+    }
+    ret.distance = ret.lowerBound = ret.upperBound = best;
+    forn(b, numBlocks){
+        if (blockResults[b].homologyDimension && blockResults[b].distance == best){
+            ret.count += blockResults[b].count;
+            if (!countAll) break;
+        }
+    }
+    return ret;
+}
+
+template<class num> vector<num> transposeColumns(const vector<num> &columns, int rows){
+    // row view of a map stored as packed columns, built from the set bits only
+    vector<num> ret(rows);
+    forn(j, sz(columns)){
+        const num &column = columns[j];
+        for (int r = column.findFirst(); r < column.size(); r = column.findNext(r)) ret[r].set(j);
+    }
+    return ret;
+}
+
+template<class num> vector<num> coboundaries(const vector<vector<num>> &matrices, int k){
+    // images of the generators of degree k under the transpose of d_(k-1),
+    // for matrices laid out as in analyzeComplex
+    int n = sz(matrices) - 2;
+    return transposeColumns(matrices[k], k <= n ? sz(matrices[k+1]) : 0);
+}
+
+template<class num> ComplexResults analyzeComplex(vector<vector<num>> &matrices, bool searchDistance, bool outputCounts,
+const vector<vector<vll>> &symmetries){
+    using vn = vector<num>;
+    ll n = sz(matrices) - 2;
+    // matrices[k] holds the packed columns of d_(k-1), the images of the
+    // generators of degree k-1, with empty maps at both ends. this is the only
+    // stored copy of the complex; the coboundary side reads rows of it
+    // through coboundaries(k), which is built per degree from the set bits and
+    // dropped once that degree is done
+    forn(i, n-1){ // d_(i+1) d_i = 0
+        forn(j, sz(matrices[i+1])){
+            num image;
+            const num &column = matrices[i+1][j];
+            for (int k = column.findFirst(); k < column.size(); k = column.findNext(k)) image ^= matrices[i+2][k];
+            assert(image.none());
+        }
+    }
+    // one pass per degree and direction
+    ComplexResults ret;
+    vector<DegreeResult> &cycleResults = ret.cycles, &cocycleResults = ret.cocycles;
+    cycleResults.resize(n+1);
+    cocycleResults.resize(n+1);
+    vector<vector<vi>> degreeSymmetries(n+1); // degreeSymmetries[i] acts on the generators of degree i
+    for (auto &g : symmetries){
+        forn(i, n+1) degreeSymmetries[i].pb(vi(all(g[i])));
+    }
+    if (searchByBlocks){
+        vector<vi> blockOf = complexBlocks(matrices);
+        int numBlocks = 0;
+        for (auto &degree : blockOf) for (int b : degree) numBlocks = max(numBlocks, b + 1);
+        ostringstream certificate;
+        forn(i, n+1){
+            cycleResults[i] = analyzeDegreeByBlocks(matrices[i], matrices[i+1], i-1, i, i+1, blockOf, numBlocks,
+            searchDistance, outputCounts, "cycles", certificate, degreeSymmetries[i]);
+        }
+        vn upper = coboundaries(matrices, 0);
+        forn(i, n+1){
+            vn lower = coboundaries(matrices, i+1);
+            cocycleResults[i] = analyzeDegreeByBlocks(lower, upper, i+1, i, i-1, blockOf, numBlocks,
+            searchDistance, outputCounts, "cocycles", certificate, degreeSymmetries[i]);
+            upper = move(lower);
+        }
+        if (outputBlockDistances){
+            cout << "Blocks:" << endl << certificate.str();
+        }
+    }
+    else forn(i, n+1){
+        cycleResults[i] = analyzeDegree(matrices[i], matrices[i+1], searchDistance, outputCounts,
+        searchKey("cycles", i, outputCounts, matrices[i], matrices[i+1]), degreeSymmetries[i]);
+    }
+    if (!searchByBlocks){
+        vn upper = coboundaries(matrices, 0);
+        forn(i, n+1){
+            vn lower = coboundaries(matrices, i+1);
+            cocycleResults[i] = analyzeDegree(lower, upper, searchDistance, outputCounts,
+            searchKey("cocycles", i, outputCounts, lower, upper), degreeSymmetries[i]);
+            upper = move(lower);
         }
     }
+    return ret;
+}
+
+template<class num> void getAllDistancesPacked(vector<vector<num>> &matrices, bool outputLengths, bool outputHomologyDimension, bool outputDistance, bool outputCounts, bool outputWeights,
+const vector<vector<vll>> &symmetries){
+    // analyzes the complex, then prints whichever parts were asked for
+    using vn = vector<num>;
+    ll n = sz(matrices) - 2;
+    ComplexResults results = analyzeComplex(matrices, outputDistance || outputCounts, outputCounts, symmetries);
+    vector<DegreeResult> &cycleResults = results.cycles, &cocycleResults = results.cocycles;
+    auto outputRow = [&](const vector<DegreeResult> &results, ll DegreeResult::*field){
+        for (auto &result : results) cout << result.*field << ' ';
+        cout << endl;
+    };
     if (outputLengths){
         cout << "Lengths:" << endl;
-        forn(i, n+1) cout << minDist(matrices[i], matrices[i+1], 1, 0, 0) << ' ';
-        cout << endl;
-        forn(i, n+1) cout << minDist(matrixTransposes[i+1], matrixTransposes[i], 1, 0, 0) << ' ';
-        cout << endl;
+        outputRow(cycleResults, &DegreeResult::dimension);
+        outputRow(cocycleResults, &DegreeResult::dimension);
     }
     if (outputHomologyDimension){
         cout << "Homology:" << endl;
-        forn(i, n+1) cout << minDist(matrices[i], matrices[i+1], 0, 1, 0) << ' ';
-        cout << endl;
-        forn(i, n+1) cout << minDist(matrixTransposes[i+1], matrixTransposes[i], 0, 1, 0) << ' ';
-        cout << endl;
+        outputRow(cycleResults, &DegreeResult::homologyDimension);
+        outputRow(cocycleResults, &DegreeResult::homologyDimension);
     }
     if (outputDistance){
         cout << "Distances:" << endl;
-        forn(i, n+1) cout << minDist(matrices[i], matrices[i+1], 0, 0, 0) << ' ';
-        cout << endl;
-        forn(i, n+1) cout << minDist(matrixTransposes[i+1], matrixTransposes[i], 0, 0, 0) << ' ';
-        cout << endl;
+        outputRow(cycleResults, &DegreeResult::distance);
+        outputRow(cocycleResults, &DegreeResult::distance);
     }
     if (outputCounts){
         cout << "Number of Minimially Weighted Elements:" << endl;
-        forn(i, n+1) cout << minDist(matrices[i], matrices[i+1], 0, 0, 1) << ' ';
-        cout << endl;
-        forn(i, n+1) cout << minDist(matrixTransposes[i+1], matrixTransposes[i], 0, 0, 1) << ' ';
-        cout << endl;
+        outputRow(cycleResults, &DegreeResult::count);
+        outputRow(cocycleResults, &DegreeResult::count);
+    }
+    if (outputWeights){
+        cout << "Weight Distributions:" << endl;
+        vn upper = coboundaries(matrices, 0);
+        forn(i, n+1){
+            vn lower = coboundaries(matrices, i+1);
+            outputWeightDistributions(matrices[i], matrices[i+1], upper, lower, "degree " + to_string(i));
+            upper = move(lower);
+        }
+        upper = coboundaries(matrices, 0);
+        forn(i, n+1){
+            vn lower = coboundaries(matrices, i+1);
+            outputWeightDistributions(lower, upper, matrices[i+1], matrices[i], "codegree " + to_string(i));
+            upper = move(lower);
+        }
+    }
+}
+
+void getAllDistances(vector<Matrix> &maps, bool outputLengths, bool outputHomologyDimension, bool outputDistance, bool outputCounts, bool outputWeights = 0,
+const vector<vector<vll>> &symmetries = {}){
+    // outputWeights prints the full weight distribution of the cycles and of
+    // the logical operators in every degree, see weightEnumerator.hpp
+    // symmetries are generator permutations from generatorPermutations, used
+    // to only enumerate one subset per orbit
+    ll n = maps.size();
+    ll maxMatrixSize = 0;
+    forn(i, n){
+        maxMatrixSize = max(maxMatrixSize, (ll)max(maps[i].r, maps[i].c));
+    }
+
+    // the bit width is chosen once for the whole complex; the extra bit is
+    // the sentinel nextPerm runs into after the last subset of a given size
+    withPackedWidth(maxMatrixSize + 1, [&](auto bits){
+        using num = decltype(bits);
+        vector<vector<num>> matrices(n+2);
+        forn(i, n) matrices[i+1] = packColumns<num>(maps[i]);
+        matrices[n+1] = vector<num>(maps[n-1].c);
+        getAllDistancesPacked(matrices, outputLengths, outputHomologyDimension, outputDistance, outputCounts, outputWeights, symmetries);
+    });
+}
+
+void requirePackedMemory(const vector<ll> &sizes, const string &source){
+    // the distance stage holds every degree as packed columns, plus the
+    // coboundary rows of two degrees at a time, which for the largest
+    // complexes is more than their sparse files. only construction and rank
+    // run out of core, so refuse here rather than run out of memory halfway
+    ll maxSize = *max_element(all(sizes));
+    ll words = packedWordCount(maxSize + 1);
+    if (!words) words = (maxSize + 64) / 64;
+    ll bytes = 2 * maxSize * words * 8;
+    for (ll size : sizes) bytes += size * words * 8;
+    ll memory = physicalMemoryBytes();
+    if (memory < 0 || bytes <= memory) return;
+    cerr << source << ": the distance stage needs at least " << (bytes >> 20) << " MB of packed columns, more than the "
+    << (memory >> 20) << " MB of memory here." << endl;
+    exit(1);
+}
+
+void getAllDistances(const string &prefix, bool outputLengths, bool outputHomologyDimension, bool outputDistance, bool outputCounts, bool outputWeights = 0,
+const vector<vector<vll>> &symmetries = {}){
+    // the same, for maps spilled to disk with spillDifferentialMaps; each file
+    // is streamed once into packed columns and no dense Matrix is ever built
+    int n = spilledMapCount(prefix);
+    assert(n > 0);
+    vector<SparseMapHeader> info(n);
+    vector<ll> sizes;
+    ll maxMatrixSize = 0;
+    forn(i, n){
+        info[i] = sparseMapInfo(prefix, i);
+        maxMatrixSize = max(maxMatrixSize, max(info[i].domain, info[i].codomain));
+        sizes.pb(info[i].domain);
+    }
+    sizes.pb(info[n-1].codomain);
+    requirePackedMemory(sizes, prefix);
+    withPackedWidth(maxMatrixSize + 1, [&](auto bits){
+        using num = decltype(bits);
+        vector<vector<num>> matrices(n+2);
+        forn(i, n) matrices[i+1] = readPackedColumns<num>(prefix, i);
+        matrices[n+1] = vector<num>(info[n-1].codomain);
+        getAllDistancesPacked(matrices, outputLengths, outputHomologyDimension, outputDistance, outputCounts, outputWeights, symmetries);
+    });
+}
+
+void getAllDistances(const BinaryMapsFile &file, bool outputLengths, bool outputHomologyDimension, bool outputDistance, bool outputCounts, bool outputWeights = 0,
+const vector<vector<vll>> &symmetries = {}){
+    // the same, for maps written by writeBinaryMaps
+    int n = file.size();
+    assert(n > 0);
+    vector<ll> sizes;
+    ll maxMatrixSize = 0;
+    forn(i, n){
+        maxMatrixSize = max(maxMatrixSize, max(file.map(i).entry.domain, file.map(i).entry.codomain));
+        sizes.pb(file.map(i).entry.domain);
+    }
+    sizes.pb(file.map(n-1).entry.codomain);
+    requirePackedMemory(sizes, "binary maps file");
+    withPackedWidth(maxMatrixSize + 1, [&](auto bits){
+        using num = decltype(bits);
+        vector<vector<num>> matrices(n+2);
+        forn(i, n) matrices[i+1] = readPackedColumns<num>(file.map(i));
+        matrices[n+1] = vector<num>(file.map(n-1).entry.codomain);
+        getAllDistancesPacked(matrices, outputLengths, outputHomologyDimension, outputDistance, outputCounts, outputWeights, symmetries);
+    });
+}
+
+ComplexResults analyzeMaps(vector<Matrix> &maps, bool searchDistance, bool countAll, const vector<vector<vll>> &symmetries = {}){
+    // the results getAllDistances would print, for code that wants them as values
+    ll n = maps.size();
+    ll maxMatrixSize = 0;
+    forn(i, n){
+        maxMatrixSize = max(maxMatrixSize, (ll)max(maps[i].r, maps[i].c));
+    }
+    ComplexResults ret;
+    withPackedWidth(maxMatrixSize + 1, [&](auto bits){
+        using num = decltype(bits);
+        vector<vector<num>> matrices(n+2);
+        forn(i, n) matrices[i+1] = packColumns<num>(maps[i]);
+        matrices[n+1] = vector<num>(maps[n-1].c);
+        ret = analyzeComplex(matrices, searchDistance, countAll, symmetries);
+    });
+    return ret;
+}
+
+string degreeField(const ComplexResults &results, ll DegreeResult::*value){
+    // the cycle side by degree, then '/', then the cocycle side
+    ostringstream out;
+    forn(i, sz(results.cycles)) out << (i ? "," : "") << results.cycles[i].*value;
+    out << '/';
+    forn(i, sz(results.cocycles)) out << (i ? "," : "") << results.cocycles[i].*value;
+    return out.str();
+}
+
+void outputRecord(ostream &out, const string &id, ll crossings, const ComplexResults &results, ll milliseconds){
+    // one line per diagram, keyed by its id:
+    //     id crossings=n lengths=... homology=... distances=... ms=t
+    out << id << " crossings=" << crossings;
+    out << " lengths=" << degreeField(results, &DegreeResult::dimension);
+    out << " homology=" << degreeField(results, &DegreeResult::homologyDimension);
+    out << " distances=" << degreeField(results, &DegreeResult::distance);
+    out << " ms=" << milliseconds << '\n';
+}
+
+string serializeResults(const ComplexResults &results){
+    // for the result cache: per side the number of degrees, then a line per
+    // degree with dimension, rank, homology and distance. the count is left
+    // out, since without countAll it depends on the order of the search and
+    // so on which labelling of the diagram happened to be computed
+    ostringstream out;
+    for (auto *side : {&results.cycles, &results.cocycles}){
+        out << side->size() << '\n';
+        for (auto &r : *side) out << r.dimension << ' ' << r.rank << ' ' << r.homologyDimension << ' ' << r.distance << '\n';
+    }
+    return out.str();
+}
+
+bool parseResults(const string &payload, ComplexResults &results){
+    istringstream in(payload);
+    string line;
+    for (auto *side : {&results.cycles, &results.cocycles}){
+        int degrees;
+        if (!(in >> degrees) || !getline(in, line)) return 0;
+        side->resize(degrees);
+        for (auto &r : *side){
+            // older payloads end every line with a count, which is ignored
+            if (!getline(in, line)) return 0;
+            istringstream fields(line);
+            if (!(fields >> r.dimension >> r.rank >> r.homologyDimension >> r.distance)) return 0;
+            r.count = 0;
+            // only finished searches are stored, but keep older payloads readable
+            r.timedOut = r.distance < 0;
+            r.lowerBound = r.timedOut ? -r.distance : r.distance;
+            r.upperBound = r.timedOut ? r.dimension : r.distance;
+        }
     }
+    return 1;
+}
+
+ComplexResults mirrorResults(const ComplexResults &results){
+    // the results of the mirror image, from those of the diagram (see
+    // mirrorPD.hpp): degree k of the mirror is degree n-k, and its complex
+    // is the transpose, so cycles and cocycles trade places
+    ComplexResults ret;
+    ret.cycles.assign(results.cocycles.rbegin(), results.cocycles.rend());
+    ret.cocycles.assign(results.cycles.rbegin(), results.cycles.rend());
+    return ret;
+}
+
+vector<Matrix> diagramMaps(PD D, const vector<vector<int>> &faces, const BatchDiagram &diagram, ComplexFamily *family = nullptr){
+    // the reduced maps, or the annular ones when there are faces. a family
+    // builds the reduced maps as a cone when D extends a diagram it has seen
+    if (faces.empty()) return family ? family->maps(D) : getMaps(D, 1);
+    if (diagram.restrictAnnularGrading) return annular::differentialMapSubcomplex(D, faces, diagram.annularGrading);
+    return annular::differentialMap(D, faces);
+}
+
+ComplexResults analyzeDiagram(const BatchDiagram &diagram, bool useSymmetries, const ResultCache *cache = nullptr, ComplexFamily *family = nullptr){
+    // non-annular diagrams take reduced homology as in main. with a cache, a
+    // diagram seen before under any relabelling, or whose mirror image was,
+    // is answered from disk; otherwise the canonical diagram is built, its
+    // maps are stored, and so are its results once no search in them has
+    // timed out
+    bool annularDiagram = !diagram.faces.empty();
+    PD D = createPlanarDiagram(diagram.crossings);
+    vector<vector<int>> faces = diagram.faces;
+    string key;
+    if (cache){
+        CanonicalPD canonical = canonicalPD(D, !annularDiagram);
+        string kind = !annularDiagram ? "reduced" : diagram.restrictAnnularGrading ? "annular@" + to_string(diagram.annularGrading) : "annular";
+        key = complexKey(canonical, kind, diagram.faces);
+        ComplexResults ret;
+        string payload;
+        if (cache->load(key, payload) && parseResults(payload, ret)) return ret;
+        if (!annularDiagram && cache->load(complexKey(canonicalPD(mirrorPD(D), 1), kind), payload) && parseResults(payload, ret)){
+            return mirrorResults(ret);
+        }
+        D = canonical.D;
+        for (auto &face : faces){
+            for (int &x : face) x = canonical.label[x];
+        }
+    }
+    vector<Matrix> maps = diagramMaps(D, faces, diagram, family);
+    vector<vector<vll>> symmetries;
+    if (!annularDiagram && useSymmetries) symmetries = generatorPermutations(D, 1);
+    if (cache && cache->onDisk() && !cache->hasMaps(key)){
+        string temporary = cache->temporaryFile(cache->mapsFile(key));
+        writeBinaryMaps(temporary, maps, D.size(), !annularDiagram, diagram.restrictAnnularGrading ? diagram.annularGrading : noAnnularGrading);
+        cache->publish(temporary, cache->mapsFile(key));
+    }
+    ComplexResults ret = analyzeMaps(maps, 1, 0, symmetries);
+    bool complete = 1;
+    for (auto *side : {&ret.cycles, &ret.cocycles}){
+        for (auto &r : *side) complete &= !r.timedOut;
+    }
+    if (cache && complete) cache->save(key, serializeResults(ret));
+    return ret;
+}
+
+vector<ll> simplifiedHomology(PD D, ll &simplifiedCrossings, bool useTangleEngine){
+    // reduced homology of D by degree, computed on the diagram simplifyPD
+    // leaves; R1 and R2 moves change the complex, so there is no distance here.
+    // split and connected sum pieces are computed one at a time (factorPD.hpp).
+    // the tangle engine never builds the cube, so it reaches far larger diagrams
+    SimplifiedPD simplification = simplifyPD(D);
+    simplifiedCrossings = simplification.D.size();
+    vector<ll> homology = factoredHomology(simplification.D, [&](PD factor){
+        vector<ll> ret;
+        if (useTangleEngine){
+            for (auto &degree : tangleHomology(factor, 1)){
+                ll dimension = 0;
+                for (auto &[q, count] : degree) dimension += count;
+                ret.pb(dimension);
+            }
+        }
+        else{
+            vector<Matrix> maps = getMaps(factor, 1);
+            ComplexResults results = analyzeMaps(maps, 0, 0);
+            for (auto &r : results.cycles) ret.pb(r.homologyDimension);
+        }
+        return ret;
+    });
+    return unshiftHomology(homology, simplification, D.size());
+}
+
+void runBatch(const string &batchFile, bool useSymmetries, const ResultCache *cache, bool homologyOnly = 0, bool useTangleEngine = 0, ComplexFamily *family = nullptr){
+    // every diagram of a batch file (see batchInput.hpp) in turn, one record
+    // each on stdout. with homologyOnly non-annular diagrams are simplified
+    // first and their records are
+    //     id crossings=n simplified=m homology=... ms=t
+    // with a family, a diagram that is an earlier one plus a last crossing is
+    // built from that one's maps. the cache relabels diagrams into canonical
+    // form, which hides such extensions, so the two do not go well together
+    DiagramBatch batch(batchFile);
+    BatchDiagram diagram;
+    while (batch.next(diagram)){
+        auto tic = chrono::steady_clock::now();
+        if (homologyOnly && diagram.faces.empty()){
+            ll simplifiedCrossings;
+            vector<ll> homology = simplifiedHomology(createPlanarDiagram(diagram.crossings), simplifiedCrossings, useTangleEngine);
+            ll milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - tic).count();
+            cout << diagram.id << " crossings=" << diagram.crossings.size() << " simplified=" << simplifiedCrossings << " homology=";
+            forn(i, sz(homology)) cout << (i ? "," : "") << homology[i];
+            cout << " ms=" << milliseconds << '\n';
+            cout.flush();
+            continue;
+        }
+        ComplexResults results = analyzeDiagram(diagram, useSymmetries, cache, family);
+        ll milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - tic).count();
+        outputRecord(cout, diagram.id, diagram.crossings.size(), results, milliseconds);
+        cout.flush();
+    }
+}
+
+string diagramLimitError(const BatchDiagram &diagram){
+    // why the builders cannot take this diagram, empty if they can. every
+    // strand joins two crossing ends and a circle is one word of strands, so
+    // at most 32 crossings; the annular code also keeps strand x at bit x-1
+    // of a 63 bit face basis
+    if (sz(diagram.crossings) > 32) return "diagram " + diagram.id + " has " + to_string(sz(diagram.crossings)) + " crossings, at most 32 are supported";
+    map<int, int> ends;
+    for (auto &crossing : diagram.crossings) for (int x : crossing) ends[x]++;
+    bool annularDiagram = !diagram.faces.empty();
+    for (auto [x, count] : ends){
+        if (x <= 0) return "strand label " + to_string(x) + " in diagram " + diagram.id + " is not positive";
+        if (count != 2) return "strand " + to_string(x) + " in diagram " + diagram.id + " appears " + to_string(count) + " times, not twice";
+        if (annularDiagram && x > 63) return "strand label " + to_string(x) + " in annular diagram " + diagram.id + " is above 63";
+    }
+    if (!annularDiagram) return "";
+    for (auto &face : diagram.faces){
+        for (int x : face) if (!ends.count(x)) return "face of diagram " + diagram.id + " has strand " + to_string(x) + ", which is not in the diagram";
+    }
+    // every circle of every resolution has to be a sum of faces (see
+    // annular::containsPuncture). circles are cycles of the graph with the
+    // crossings as vertices and the strands as edges, so it is enough that
+    // the cycles closed by the strands outside a spanning forest are
+    vector<ll> basis(63);
+    for (auto &face : diagram.faces){
+        ll mask = 0;
+        for (int x : face) mask += (1ll << (x-1)); // as the annular code reads faces
+        insertVector(basis, mask);
+    }
+    map<int, vector<int>> at; // strand -> the crossings at its two ends
+    forn(i, sz(diagram.crossings)) for (int x : diagram.crossings[i]) at[x].pb(i);
+    int n = sz(diagram.crossings);
+    vector<int> parent(n, -1), depth(n, 0);
+    vector<ll> up(n, 0); // the strand from a crossing to its parent, as a mask
+    vector<vector<pair<int, int>>> adjacent(n);
+    for (auto &[x, ends] : at) if (ends[0] != ends[1]){
+        adjacent[ends[0]].pb({ends[1], x});
+        adjacent[ends[1]].pb({ends[0], x});
+    }
+    vector<bool> seen(n, 0);
+    set<int> treeStrands;
+    forn(root, n){
+        if (seen[root]) continue;
+        seen[root] = 1;
+        vector<int> stack = {root};
+        while (!stack.empty()){
+            int v = stack.back();
+            stack.pop_back();
+            for (auto [w, x] : adjacent[v]){
+                if (seen[w]) continue;
+                seen[w] = 1;
+                parent[w] = v;
+                depth[w] = depth[v] + 1;
+                up[w] = 1ll << (x-1);
+                treeStrands.insert(x);
+                stack.pb(w);
+            }
+        }
+    }
+    for (auto &[x, ends] : at){
+        if (treeStrands.count(x)) continue;
+        ll cycle = 1ll << (x-1);
+        int a = ends[0], b = ends[1];
+        while (a != b){
+            if (depth[a] < depth[b]) swap(a, b);
+            cycle ^= up[a];
+            a = parent[a];
+        }
+        if (isLinearlyIndependent(basis, cycle)) return "the faces of diagram " + diagram.id + " do not fit its crossings";
+    }
+    return "";
+}
+
+string serveRequest(const string &request, bool useSymmetries, const ResultCache &cache){
+    // a request is "results" or "maps" followed by one line of a batch file,
+    // and the answer is one of
+    //     ok <record, as batchMode prints it>
+    //     ok <size>, then a binary maps file of that many bytes for the diagram as given
+    //     error <why>
+    // results go through the cache, which the server keeps warm between requests
+    size_t space = request.find(' ');
+    string command = request.substr(0, space);
+    if (space == string::npos || (command != "results" && command != "maps")) return "error expected results or maps\n";
+    BatchDiagram diagram;
+    string error;
+    if (!parseDiagramLine(request.data() + space + 1, request.data() + request.size(), diagram, error)) return "error " + error + "\n";
+    error = diagramLimitError(diagram);
+    if (!error.empty()) return "error " + error + "\n";
+    if (command == "maps"){
+        PD D = createPlanarDiagram(diagram.crossings);
+        vector<Matrix> maps = diagramMaps(D, diagram.faces, diagram);
+        string bytes = binaryMapsBytes(maps, D.size(), diagram.faces.empty(), diagram.restrictAnnularGrading ? diagram.annularGrading : noAnnularGrading);
+        return "ok " + to_string(bytes.size()) + "\n" + bytes;
+    }
+    auto tic = chrono::steady_clock::now();
+    ComplexResults results = analyzeDiagram(diagram, useSymmetries, &cache);
+    ll milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - tic).count();
+    ostringstream out;
+    out << "ok ";
+    outputRecord(out, diagram.id, diagram.crossings.size(), results, milliseconds);
+    return out.str();
+}
+
+ll predictedBytes(const vector<ll> &sizes){
+    // rough peak memory of building and analyzing a complex with these chain
+    // group sizes: the resolution cube, the dense maps, and a few packed
+    // copies of every degree for the eliminations and the coboundary side
+    int n = sz(sizes) - 1;
+    ll words = (*max_element(all(sizes)) + 64) / 64;
+    ll ret = (16ll << 20) + (1ll << n) * 32;
+    forn(i, n) ret += sizes[i] * sizes[i+1] / 8 + sizes[i] * 40;
+    for (ll size : sizes) ret += 4 * size * words * 8;
+    return ret;
+}
+
+void runSweep(const string &batchFile, bool useSymmetries, const SchedulerLimits &limits, const ResultCache *cache){
+    // the whole batch file through runJobs, largest complexes first, then
+    // one tab separated table in input order on stdout
+    vector<BatchDiagram> diagrams;
+    DiagramBatch batch(batchFile);
+    BatchDiagram diagram;
+    while (batch.next(diagram)) diagrams.pb(diagram);
+    vector<ll> predicted;
+    for (auto &d : diagrams){
+        PD D = createPlanarDiagram(d.crossings);
+        predicted.pb(predictedBytes(chainGroupSizes(D, d.faces.empty())));
+    }
+    vector<JobResult> results = runJobs(predicted, [&](int job){
+        ComplexResults ret = analyzeDiagram(diagrams[job], useSymmetries, cache);
+        return degreeField(ret, &DegreeResult::dimension) + '\t' + degreeField(ret, &DegreeResult::homologyDimension) + '\t'
+        + degreeField(ret, &DegreeResult::distance);
+    }, limits);
+    cout << "id\tcrossings\tpredictedMB\tpeakMB\tms\tlengths\thomology\tdistances\n";
+    forn(i, sz(diagrams)){
+        const JobResult &result = results[i];
+        cout << diagrams[i].id << '\t' << diagrams[i].crossings.size() << '\t' << (predicted[i] >> 20) << '\t'
+        << (result.peakBytes < 0 ? -1 : result.peakBytes >> 20) << '\t' << result.milliseconds << '\t'
+        << (result.failed ? "failed\tfailed\tfailed" : result.output) << '\n';
+    }
+    cout.flush();
 }
 
 int main(){
     bool takeAnnular = 1;
     bool restrictAnnularGrading = 1;
+    bool useSymmetries = 1; // diagram symmetries, only for non-annular input
+    bool outputWeights = 0; // also print the weight distributions of the cycles and logical operators, see weightEnumerator.hpp
+    bool spillMaps = 0; // build the maps straight to disk and read them back, only for non-annular input
+    string spillPrefix = "maps"; // the maps go to spillPrefix.d0, spillPrefix.d1, ...
+    bool readBinaryMaps = 0; // read the maps from a file written by outputDifferentialMaps instead of building them
+    string binaryMapsFile = "output.khm";
+    bool batchMode = 0; // every diagram in batchFile instead of input.txt, one record per line
+    string batchFile = "batch.txt";
+    bool homologyOnly = 0; // batchMode prints only homology, computed after Reidemeister I and II simplification
+    bool useTangleEngine = 0; // homologyOnly goes through tangleHomology instead of the cube
+    bool reuseCones = 0; // batchMode builds diagrams that extend earlier ones by a crossing as mapping cones, see mappingCone.hpp
+    string familyDirectory = "khfamily"; // where reuseCones keeps the spilled maps of the batch
+    bool sweepMode = 0; // batchFile through runJobs in parallel, one table for the whole sweep
+    SchedulerLimits limits; // workers and memory caps for sweepMode
+    bool useResultCache = 0; // batch and sweep results and maps are kept in cacheDirectory across runs
+    string cacheDirectory = "khcache";
+    bool serverMode = 0; // answer requests on socketPath until told to quit, see serveRequest
+    string socketPath = "khovanov.sock";
+    if (serverMode){
+        ResultCache cache(useResultCache ? cacheDirectory : ""); // in memory only without useResultCache
+        useCheckpoints = 0; // many short searches, finished results go to the cache instead
+        runLocalServer(socketPath, [&](const string &request){
+            return serveRequest(request, useSymmetries, cache);
+        });
+        return 0;
+    }
+    if (batchMode || sweepMode){
+        unique_ptr<ResultCache> cache;
+        if (useResultCache) cache.reset(new ResultCache(cacheDirectory));
+        unique_ptr<ComplexFamily> family;
+        if (reuseCones) family.reset(new ComplexFamily(familyDirectory, 1));
+        useCheckpoints = 0; // many short searches, finished results go to the cache instead
+        if (sweepMode) runSweep(batchFile, useSymmetries, limits, cache.get());
+        else runBatch(batchFile, useSymmetries, cache.get(), homologyOnly, useTangleEngine, family.get());
+        return 0;
+    }
+    if (readBinaryMaps){ // the file does not carry the diagram, so no symmetries
+        startCheckpointing();
+        getAllDistances(BinaryMapsFile(binaryMapsFile), 1, 1, 1, 1, outputWeights);
+        return 0;
+    }
     vector<Matrix> maps;
+    vector<vector<vll>> symmetries;
     if (takeAnnular) maps = annular::planarDiagramToMaps(restrictAnnularGrading);
-    else maps = getMaps(getPlanarDiagram(), 1); // always takes reduced homology
+    else{
+        PD D = getPlanarDiagram();
+        if (spillMaps) spillDifferentialMaps(D, 1, spillPrefix); // always takes reduced homology
+        else maps = getMaps(D, 1); // always takes reduced homology
+        if (useSymmetries) symmetries = generatorPermutations(D, 1);
+    }
 
     // maps = getMatrices();
-    getAllDistances(maps, 1, 1, 1, 1);
+    startCheckpointing(); // resumes any search saved in checkpointFile
+    if (spillMaps && !takeAnnular) getAllDistances(spillPrefix, 1, 1, 1, 1, outputWeights, symmetries);
+    else getAllDistances(maps, 1, 1, 1, 1, outputWeights, symmetries);
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+#ifndef FACTOR_PD
+#define FACTOR_PD
+#include <vector>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include "differentialMaps.hpp"
+
+using namespace std;
+
+// pieces of a diagram whose complexes tensor together. crossings that share
+// no strand with the rest form a split diagram, [[D1 u D2]] = [[D1]] x [[D2]],
+// and two strands that are the only link between two groups of crossings
+// make a connected sum: joining the two strands on either side gives D1 and
+// D2 with [[D1 # D2]] = [[D1]] x_A [[D2]]. either way a resolution of D is one
+// of each piece, so degrees (numbers of 1-resolutions) add. over F2 the
+// unreduced homology of any diagram is its reduced homology tensored with A,
+// whichever strand is marked (Shumakovitch), so by the Kunneth formula
+//     Khr(D1 u D2) = Khr(D1) x Khr(D2) x A,    Khr(D1 # D2) = Khr(D1) x Khr(D2)
+// and only the prime pieces need a complex: an 8+8 crossing split link takes
+// two cubes of 2^8 resolutions instead of one of 2^16. this is homology
+// only; the complexes themselves, and their distances, do not factor
+
+class DiagramFactors{
+    public:
+        vector<PD> factors; // neither split nor a connected sum, strands labelled 1, 2, ...
+        int splitJoins = 0; // disjoint unions among the joins, each one more factor of A
+};
+
+vector<int> crossingGroups(const vector<vector<int>> &crossings, int skip1, int skip2, int &groups){
+    // the group of every crossing, joining crossings that share a strand other than skip1 and skip2
+    int n = crossings.size();
+    vector<int> parent(n);
+    for (int i = 0; i < n; i++) parent[i] = i;
+    auto root = [&](int x){
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    };
+    map<int, int> seenAt; // strand -> a crossing it meets
+    for (int i = 0; i < n; i++){
+        for (int x : crossings[i]){
+            if (x == skip1 || x == skip2) continue;
+            auto it = seenAt.find(x);
+            if (it == seenAt.end()) seenAt[x] = i;
+            else parent[root(i)] = root(it->second);
+        }
+    }
+    map<int, int> groupOf;
+    vector<int> ret(n);
+    for (int i = 0; i < n; i++){
+        int r = root(i);
+        if (!groupOf.count(r)){
+            int next = groupOf.size();
+            groupOf[r] = next;
+        }
+        ret[i] = groupOf[r];
+    }
+    groups = groupOf.size();
+    return ret;
+}
+
+PD labelledInOrder(const vector<vector<int>> &crossings){
+    // the same diagram with strands renumbered 1, 2, ... in order of appearance
+    map<int, int> label;
+    PD ret(crossings.size());
+    for (int i = 0; i < (int)crossings.size(); i++){
+        for (int k = 0; k < 4; k++){
+            int x = crossings[i][k];
+            if (!label.count(x)){
+                int next = label.size() + 1;
+                label[x] = next;
+            }
+            ret.crossings[i][k] = label[x];
+        }
+    }
+    return ret;
+}
+
+void factorCrossings(const vector<vector<int>> &crossings, DiagramFactors &ret){
+    int groups;
+    vector<int> group = crossingGroups(crossings, 0, 0, groups); // strands are labelled from 1
+    if (groups > 1){
+        ret.splitJoins += groups - 1;
+        for (int g = 0; g < groups; g++){
+            vector<vector<int>> piece;
+            for (int i = 0; i < (int)crossings.size(); i++) if (group[i] == g) piece.push_back(crossings[i]);
+            factorCrossings(piece, ret);
+        }
+        return;
+    }
+    // a connected sum: two strands whose removal leaves two groups, each
+    // strand with one end in either. removing two edges of a connected
+    // 4-valent graph leaves at most two groups, and no single edge splits it
+    vector<int> labels;
+    for (auto &c : crossings) for (int x : c) labels.push_back(x);
+    sort(labels.begin(), labels.end());
+    labels.erase(unique(labels.begin(), labels.end()), labels.end());
+    for (int s = 0; s < (int)labels.size(); s++){
+        for (int t = s + 1; t < (int)labels.size(); t++){
+            int a = labels[s], b = labels[t];
+            group = crossingGroups(crossings, a, b, groups);
+            if (groups != 2) continue;
+            vector<vector<int>> sides[2];
+            for (int i = 0; i < (int)crossings.size(); i++) sides[group[i]].push_back(crossings[i]);
+            for (auto &side : sides){ // close each side up by joining its ends of a and b
+                for (auto &c : side) for (int &x : c) if (x == b) x = a;
+                factorCrossings(side, ret);
+            }
+            return;
+        }
+    }
+    ret.factors.push_back(labelledInOrder(crossings));
+}
+
+DiagramFactors factorPD(PD D){
+    DiagramFactors ret;
+    if (D.size() > 0) factorCrossings(D.crossings, ret);
+    return ret;
+}
+
+vector<ll> tensorHomology(const vector<ll> &a, const vector<ll> &b){
+    // homology by degree of a tensor product of complexes over a field, from the factors'
+    vector<ll> ret(a.size() + b.size() - 1, 0);
+    for (int i = 0; i < (int)a.size(); i++){
+        for (int j = 0; j < (int)b.size(); j++) ret[i+j] += a[i] * b[j];
+    }
+    return ret;
+}
+
+vector<ll> factoredHomology(PD D, const function<vector<ll>(PD)> &reducedHomology){
+    // reduced homology of D by degree over F2, with reducedHomology called on
+    // the prime pieces only. a diagram without crossings is the unknot
+    DiagramFactors factorization = factorPD(D);
+    vector<ll> ret = {1};
+    for (auto &factor : factorization.factors) ret = tensorHomology(ret, reducedHomology(factor));
+    for (int i = 0; i < factorization.splitJoins; i++){
+        for (ll &x : ret) x *= 2;
+    }
+    return ret;
+}
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef JOB_SCHEDULER
+#define JOB_SCHEDULER
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <thread>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <cerrno>
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+using ll = long long;
+
+// runs many independent jobs, each in a worker process of its own. the
+// distance search keeps its state in globals (the packed width, the
+// checkpointed searches), so separate processes are what lets several
+// diagrams run at once, and they also give every job its own peak memory.
+// jobs are started largest predicted memory first. a job is only admitted
+// while the predicted memory of everything running stays under memoryCap,
+// and jobs above exclusiveBytes run with nothing beside them. without fork
+// the jobs simply run one after another in this process
+
+class SchedulerLimits{
+    public:
+        int workers = max(1u, thread::hardware_concurrency()); // jobs running at once
+        ll memoryCap = 8ll << 30; // bytes of predicted memory over all running jobs
+        ll exclusiveBytes = 2ll << 30; // jobs predicted above this run alone
+};
+
+class JobResult{
+    public:
+        string output; // what the job returned, empty if it failed
+        bool failed = 0;
+        ll milliseconds = 0; // wall clock
+        ll peakBytes = -1; // peak resident memory of the worker, -1 where unknown
+};
+
+vector<JobResult> runJobs(const vector<ll> &predictedBytes, const function<string(int)> &work, const SchedulerLimits &limits = SchedulerLimits()){
+    // work(i) computes job i and returns its output, which comes back through
+    // a pipe. results are in job order
+    int numJobs = predictedBytes.size();
+    vector<JobResult> results(numJobs);
+    vector<int> order(numJobs);
+    for (int i = 0; i < numJobs; i++) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](int a, int b){
+        return predictedBytes[a] > predictedBytes[b];
+    });
+
+#ifdef _WIN32
+    for (int job : order){
+        auto tic = chrono::steady_clock::now();
+        results[job].output = work(job);
+        results[job].milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - tic).count();
+    }
+#else
+    class Running{
+        public:
+            int job;
+            pid_t pid;
+            int pipe;
+            chrono::steady_clock::time_point start;
+            string output; // read so far
+    };
+    vector<Running> running;
+    ll runningBytes = 0;
+    bool exclusiveRunning = 0;
+    size_t next = 0;
+    cout.flush();
+    cerr.flush();
+    while (next < order.size() || !running.empty()){
+        // admit jobs in order while they fit
+        while (next < order.size() && (int)running.size() < limits.workers){
+            int job = order[next];
+            bool exclusive = predictedBytes[job] > limits.exclusiveBytes;
+            bool fits = running.empty() || (!exclusive && !exclusiveRunning && runningBytes + predictedBytes[job] <= limits.memoryCap);
+            if (!fits) break;
+            int fds[2];
+            if (pipe(fds) != 0){
+                cerr << "Could not create a pipe for a worker." << endl;
+                exit(1);
+            }
+            pid_t pid = fork();
+            if (pid < 0){
+                cerr << "Could not start a worker." << endl;
+                exit(1);
+            }
+            if (pid == 0){
+                close(fds[0]);
+                string output = work(job);
+                for (size_t written = 0; written < output.size(); ){
+                    ssize_t k = write(fds[1], output.data() + written, output.size() - written);
+                    if (k <= 0) _exit(1);
+                    written += k;
+                }
+                close(fds[1]);
+                cout.flush();
+                cerr.flush();
+                _exit(0);
+            }
+            close(fds[1]);
+            running.push_back({job, pid, fds[0], chrono::steady_clock::now(), ""});
+            runningBytes += predictedBytes[job];
+            exclusiveRunning |= exclusive;
+            next++;
+        }
+
+        // drain every worker's pipe as it fills, a worker blocks writing to a
+        // full one and never exits, and reap a worker once its pipe is closed
+        vector<pollfd> fds(running.size());
+        for (size_t i = 0; i < running.size(); i++) fds[i] = {running[i].pipe, POLLIN, 0};
+        if (::poll(fds.data(), fds.size(), -1) < 0){
+            if (errno == EINTR) continue;
+            cerr << "Lost track of the workers." << endl;
+            exit(1);
+        }
+        vector<Running> stillRunning;
+        for (size_t i = 0; i < running.size(); i++){
+            Running &r = running[i];
+            if (!fds[i].revents){
+                stillRunning.push_back(move(r));
+                continue;
+            }
+            char buffer[1 << 16];
+            ssize_t k = read(r.pipe, buffer, sizeof(buffer));
+            if (k > 0 || (k < 0 && errno == EINTR)){
+                if (k > 0) r.output.append(buffer, k);
+                stillRunning.push_back(move(r));
+                continue;
+            }
+            close(r.pipe);
+            int status;
+            struct rusage usage;
+            if (wait4(r.pid, &status, 0, &usage) < 0){
+                cerr << "Lost track of the workers." << endl;
+                exit(1);
+            }
+            JobResult &result = results[r.job];
+            result.milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - r.start).count();
+            result.peakBytes = usage.ru_maxrss * 1024ll; // kilobytes on Linux
+            result.failed = k < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+            if (!result.failed) result.output = move(r.output);
+            runningBytes -= predictedBytes[r.job];
+            if (predictedBytes[r.job] > limits.exclusiveBytes) exclusiveRunning = 0;
+        }
+        running = move(stillRunning);
+    }
+#endif
+    return results;
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef LOCAL_SERVER
+#define LOCAL_SERVER
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+using namespace std;
+
+// a resident server on a unix domain socket, so that a client sending many
+// small queries pays for start-up, parsing tables and cold caches only once.
+// every request is one line and handle returns the whole response, which
+// may hold binary data. clients are served from one thread, in the order
+// their lines arrive, since the computations keep their state in globals.
+// the request "quit" stops the server. from a shell:
+//     echo "results 3_1 1 5 2 4 3 1 4 6 5 3 6 2" | socat - UNIX-CONNECT:khovanov.sock
+
+void runLocalServer(const string &socketPath, const function<string(const string&)> &handle){
+#ifdef _WIN32
+    cerr << "The server needs unix domain sockets, which this build does not have." << endl;
+    exit(1);
+#else
+    signal(SIGPIPE, SIG_IGN); // a client that hangs up should not take the server down
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (listener < 0 || socketPath.size() >= sizeof(address.sun_path)){
+        cerr << "Could not create a socket at " << socketPath << "." << endl;
+        exit(1);
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+    unlink(socketPath.c_str()); // left over from an earlier server
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0){
+        cerr << "Could not listen on " << socketPath << "." << endl;
+        exit(1);
+    }
+    cerr << "Listening on " << socketPath << endl;
+
+    vector<pollfd> fds = {{listener, POLLIN, 0}};
+    vector<string> pending = {""}; // unfinished request line of each client, parallel to fds
+    auto send = [&](int fd, const string &response){
+        for (size_t written = 0; written < response.size(); ){
+            ssize_t k = write(fd, response.data() + written, response.size() - written);
+            if (k <= 0) return;
+            written += k;
+        }
+    };
+    bool running = 1;
+    while (running){
+        if (poll(fds.data(), fds.size(), -1) < 0) continue;
+        if (fds[0].revents & POLLIN){
+            int client = accept(listener, nullptr, nullptr);
+            if (client >= 0){
+                fds.push_back({client, POLLIN, 0});
+                pending.push_back("");
+            }
+        }
+        for (size_t i = 1; i < fds.size() && running; i++){
+            if (!fds[i].revents) continue;
+            char buffer[1 << 16];
+            ssize_t k = read(fds[i].fd, buffer, sizeof(buffer));
+            if (k <= 0){
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                continue;
+            }
+            pending[i].append(buffer, k);
+            size_t start = 0, end;
+            while ((end = pending[i].find('\n', start)) != string::npos){
+                string request = pending[i].substr(start, end - start);
+                start = end + 1;
+                if (!request.empty() && request.back() == '\r') request.pop_back();
+                if (request == "quit"){
+                    running = 0;
+                    break;
+                }
+                send(fds[i].fd, handle(request));
+            }
+            pending[i].erase(0, start);
+        }
+        // drop the clients that hung up
+        for (size_t i = fds.size() - 1; i >= 1; i--){
+            if (fds[i].fd == -1){
+                fds.erase(fds.begin() + i);
+                pending.erase(pending.begin() + i);
+            }
+        }
+    }
+    for (auto &fd : fds) close(fd.fd);
+    unlink(socketPath.c_str());
+#endif
+}
+
+#endif
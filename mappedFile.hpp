@@ -0,0 +1,73 @@
+#ifndef MAPPED_FILE
+#define MAPPED_FILE
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+// a whole file as one read-only buffer, mapped with mmap where it exists and
+// read in one go otherwise
+
+class MappedFile{
+    private:
+        const char *base = nullptr;
+        size_t fileSize = 0;
+        bool mapped = 0;
+        vector<char> contents;
+    public:
+        MappedFile(const string &path){
+#ifndef _WIN32
+            int fd = open(path.c_str(), O_RDONLY);
+            struct stat info;
+            if (fd != -1 && fstat(fd, &info) == 0 && info.st_size > 0){
+                void *ret = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (ret != MAP_FAILED){
+                    base = static_cast<const char*>(ret);
+                    fileSize = info.st_size;
+                    mapped = 1;
+                }
+            }
+            if (fd != -1) ::close(fd);
+#endif
+            if (!mapped){
+                FILE *file = fopen(path.c_str(), "rb");
+                if (!file){
+                    cerr << "Could not open " << path << "." << endl;
+                    exit(1);
+                }
+                fseek(file, 0, SEEK_END);
+                contents.resize(ftell(file));
+                fseek(file, 0, SEEK_SET);
+                if (fread(contents.data(), 1, contents.size(), file) != contents.size()){
+                    cerr << "Could not read " << path << "." << endl;
+                    exit(1);
+                }
+                fclose(file);
+                base = contents.data();
+                fileSize = contents.size();
+            }
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile(){
+#ifndef _WIN32
+            if (mapped) munmap(const_cast<char*>(base), fileSize);
+#endif
+        }
+        const char* data() const{
+            return base;
+        }
+        size_t size() const{
+            return fileSize;
+        }
+};
+
+#endif
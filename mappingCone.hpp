@@ -0,0 +1,260 @@
+#ifndef MAPPING_CONE
+#define MAPPING_CONE
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <cassert>
+#include <filesystem>
+#include "differentialMaps.hpp"
+#include "diskMaps.hpp"
+
+using namespace std;
+
+// the complex of a diagram as the mapping cone of the saddle at its last
+// crossing, from the complexes of its two resolutions there. resolutions are
+// numbered with the last crossing as the highest bit, so in every degree the
+// generators with that crossing at 0 come first, in the order the diagram
+// resolved at 0 numbers them, and are followed by those of the diagram
+// resolved at 1 one degree lower. this holds exactly when the two strands the
+// resolution joins keep the smaller of their labels, since circles are ordered
+// by their smallest strand (and the marked strand stays the smallest), which
+// is how resolvedDiagram labels them. then
+//     d = ( d0  0  )
+//         ( S   d1 )
+// and only the saddle S has to come from the cube, one edge per resolution of
+// the other crossings instead of the n edges of every resolution. complexes
+// are kept in the spilled form of diskMaps.hpp, where the diagonal blocks are
+// just the resolved diagrams' columns with the rows of d1 moved down
+
+PD resolvedDiagram(PD D, int resolution){
+    // D without its last crossing, resolved there: 0 pairs positions 0-1 and
+    // 2-3, 1 pairs 0-3 and 1-2, as in the cube
+    int n = D.size();
+    vector<int> c = D.crossings[n-1];
+    vector<pair<int, int>> joined = resolution == 0 ? vector<pair<int, int>>{{c[0], c[1]}, {c[2], c[3]}} : vector<pair<int, int>>{{c[0], c[3]}, {c[1], c[2]}};
+    PD ret(n-1);
+    for (int i = 0; i < n-1; i++) ret.crossings[i] = D.crossings[i];
+    for (auto [a, b] : joined){
+        if (a == b) continue;
+        int from = max(a, b), to = min(a, b);
+        for (auto &crossing : ret.crossings) for (int &x : crossing) if (x == from) x = to;
+        for (auto &other : joined){ // the second pair may run through the first
+            if (other.first == from) other.first = to;
+            if (other.second == from) other.second = to;
+        }
+    }
+    return ret;
+}
+
+bool resolvesWithoutFreeCircles(PD D){
+    // whether both resolutions at the last crossing leave every circle on
+    // some other crossing. a circle made only of strands at the last crossing
+    // would drop out of the resolved diagram, and with it half the generators
+    int n = D.size();
+    if (n < 2) return 0;
+    set<int> elsewhere;
+    for (int i = 0; i < n-1; i++) for (int x : D.crossings[i]) elsewhere.insert(x);
+    const vector<int> &c = D.crossings[n-1];
+    for (int resolution = 0; resolution < 2; resolution++){
+        int pairs[2][2] = {{0, resolution == 0 ? 1 : 3}, {2, resolution == 0 ? 3 : 1}};
+        // the strands at the crossing joined into circles or paths
+        vector<int> group = {0, 1, 2, 3};
+        auto root = [&](int x){
+            while (group[x] != x) x = group[x];
+            return x;
+        };
+        for (auto &p : pairs) group[root(p[0])] = root(p[1]);
+        for (int a = 0; a < 4; a++) for (int b = 0; b < 4; b++) if (c[a] == c[b]) group[root(a)] = root(b);
+        for (int g = 0; g < 4; g++){
+            bool meetsOthers = 0;
+            for (int a = 0; a < 4; a++) if (root(a) == root(g) && elsewhere.count(c[a])) meetsOthers = 1;
+            if (!meetsOthers) return 0;
+        }
+    }
+    return 1;
+}
+
+class SaddleColumns{
+    // the saddle images of the zero part of degree k, a generator at a time in
+    // the cone's order: resolutions r of the other crossings with k bits set,
+    // increasing, each followed along its edge to r with the last crossing at 1
+    private:
+        CircleTable &table;
+        bool reducedHomology;
+        int marked, k;
+        ll last, r = -1, subset = 0, generators = 0;
+        ll rowShift, oneStart = 0, oneGenerators = 0; // rows of the one part start at rowShift
+        int capacity = 64; // circle ids the positions can hold, grown as the table interns more
+        CirclePositions oldPositions, newPositions;
+        int oldIds[64], newIds[64];
+        CircleList oldCircles, newCircles, none;
+        CubeEdge edge;
+        void advance(){
+            if (r < 0) r = (1ll << k) - 1;
+            else{ // the next number with k bits set
+                ll lowest = r & -r, higher = r + lowest;
+                r = (((higher ^ r) >> 2) / lowest) | higher;
+            }
+            assert(r < last);
+            oldCircles.count = resolutionCircles(table, r, oldIds);
+            newCircles.count = resolutionCircles(table, r | last, newIds);
+            if (table.size() > capacity){
+                capacity = 2 * table.size();
+                oldPositions = CirclePositions(capacity);
+                newPositions = CirclePositions(capacity);
+            }
+            oldPositions.load(oldCircles);
+            newPositions.load(newCircles);
+            edge = cubeEdge(oldCircles, newCircles, oldPositions, newPositions);
+            oldPositions.load(none); // the id buffers are refilled next round
+            newPositions.load(none);
+            oneStart += oneGenerators;
+            oneGenerators = 1ll << (newCircles.count - marked);
+            generators = 1ll << (oldCircles.count - marked);
+            subset = 0;
+        }
+    public:
+        SaddleColumns(CircleTable &circleTable, int n, int degree, ll shift, bool reduced) :
+            table(circleTable), reducedHomology(reduced), marked(reduced ? 1 : 0), k(degree), last(1ll << (n-1)),
+            rowShift(shift), oldPositions(64), newPositions(64){
+            oldCircles.ids = oldIds, newCircles.ids = newIds;
+        }
+        int next(ll *rows){ // rows of the next column, increasing
+            while (subset == generators) advance();
+            ll images[2];
+            int count = differentialImages(edge, subset++, reducedHomology, images);
+            if (count == 2 && images[0] > images[1]) swap(images[0], images[1]);
+            for (int t = 0; t < count; t++) rows[t] = rowShift + oneStart + images[t];
+            return count;
+        }
+        ll oneGeneratorsSeen() const{ // generators of the one part of degree k reached so far
+            return oneStart + oneGenerators;
+        }
+};
+
+vector<ll> coneSpilledMaps(PD D, const string &zeroPrefix, const string &onePrefix, bool reducedHomology, const string &prefix){
+    // writes the maps of D to prefix.d0, ... as spillDifferentialMaps would,
+    // from the spilled maps of resolvedDiagram(D, 0) under zeroPrefix and of
+    // resolvedDiagram(D, 1) under onePrefix, and returns the chain group
+    // dimensions. the diagonal blocks are copied a column at a time with the
+    // one part's rows moved down, so the work is linear in the entries
+    int n = D.size();
+    auto sizes = [&](const string &spilled){ // dimension of every degree 0..n-1
+        vector<ll> ret(n, 0);
+        for (int k = 0; k < n-1; k++) ret[k] = sparseMapInfo(spilled, k).domain;
+        ret[n-1] = sparseMapInfo(spilled, n-2).codomain;
+        return ret;
+    };
+    vector<ll> zeroSizes = sizes(zeroPrefix), oneSizes = sizes(onePrefix);
+    zeroSizes.push_back(0); // degree n, reached only with the last crossing at 1
+    vector<ll> dimension(n+1);
+    for (int k = 0; k <= n; k++) dimension[k] = zeroSizes[k] + (k >= 1 ? oneSizes[k-1] : 0);
+
+    CircleTable table(D);
+    vector<ll> rows;
+    for (int k = 0; k < n; k++){
+        SparseMapWriter writer(sparseMapFile(prefix, k), dimension[k], dimension[k+1]);
+        SaddleColumns saddle(table, n, k, zeroSizes[k+1], reducedHomology);
+        // the zero part: d0's column, then the saddle's rows below it
+        if (zeroSizes[k]) writer.startBlock(0, zeroSizes[k]);
+        auto writeZeroColumn = [&](const ll *zeroRows, ll count){
+            rows.assign(zeroRows, zeroRows + count);
+            ll images[2];
+            int saddleCount = saddle.next(images);
+            rows.insert(rows.end(), images, images + saddleCount);
+            writer.writeColumn(rows.data(), rows.size());
+        };
+        if (k < n-1){
+            SparseMapReader reader(sparseMapFile(zeroPrefix, k));
+            reader.forEachColumn([&](ll, const ll *zeroRows, ll count){
+                writeZeroColumn(zeroRows, count);
+            });
+        }
+        else for (ll j = 0; j < zeroSizes[k]; j++) writeZeroColumn(nullptr, 0);
+        if (zeroSizes[k]) assert(saddle.oneGeneratorsSeen() == oneSizes[k]);
+        // the one part: d1's column, moved below the zero part
+        if (k >= 1 && oneSizes[k-1]){
+            writer.startBlock(zeroSizes[k], oneSizes[k-1]);
+            SparseMapReader reader(sparseMapFile(onePrefix, k-1));
+            reader.forEachColumn([&](ll, const ll *oneRows, ll count){
+                rows.resize(count);
+                for (ll t = 0; t < count; t++) rows[t] = zeroSizes[k+1] + oneRows[t];
+                writer.writeColumn(rows.data(), count);
+            });
+        }
+    }
+    for (int i = n; remove(sparseMapFile(prefix, i).c_str()) == 0; i++); // left over from a larger diagram
+    return dimension;
+}
+
+void removeSpilledMaps(const string &prefix){
+    for (int i = 0; remove(sparseMapFile(prefix, i).c_str()) == 0; i++);
+}
+
+class ComplexFamily{
+    // spilled maps of the diagrams of a family, each one the previous plus a
+    // last crossing (twist sequences, braid words growing at the end), under
+    // directory/0, directory/1, ... a diagram with a resolution already known
+    // is built as the cone over it, with the other resolution computed (by the
+    // same rule) on the spot; anything else goes through spillDifferentialMaps
+    private:
+        string directory;
+        bool reducedHomology;
+        map<vector<vector<int>>, string> known;
+        int files = 0;
+        int cones = 0;
+        string build(PD D, bool keep){
+            auto it = known.find(D.crossings);
+            if (it != known.end()) return it->second;
+            string prefix = directory + "/" + to_string(files++);
+            PD zero, one;
+            bool cone = resolvesWithoutFreeCircles(D);
+            if (cone){
+                zero = resolvedDiagram(D, 0), one = resolvedDiagram(D, 1);
+                cone = known.count(zero.crossings) || known.count(one.crossings);
+            }
+            if (cone){
+                bool zeroKnown = known.count(zero.crossings), oneKnown = known.count(one.crossings);
+                string zeroPrefix = build(zero, 0), onePrefix = build(one, 0);
+                coneSpilledMaps(D, zeroPrefix, onePrefix, reducedHomology, prefix);
+                if (!zeroKnown) removeSpilledMaps(zeroPrefix);
+                if (!oneKnown) removeSpilledMaps(onePrefix);
+                cones++;
+            }
+            else spillDifferentialMaps(D, reducedHomology, prefix);
+            if (keep) known[D.crossings] = prefix;
+            return prefix;
+        }
+    public:
+        ComplexFamily(const string &familyDirectory, bool reduced) : directory(familyDirectory), reducedHomology(reduced){
+            error_code error;
+            filesystem::create_directories(directory, error);
+            if (error){
+                cerr << "Could not create the directory " << directory << "." << endl;
+                exit(1);
+            }
+        }
+        ~ComplexFamily(){
+            forget();
+        }
+        string spilled(PD D){
+            // the prefix D's maps are spilled under, kept for the diagrams that extend D
+            return build(D, 1);
+        }
+        vector<Matrix> maps(PD D){
+            string prefix = spilled(D);
+            vector<Matrix> ret;
+            for (int k = 0; k < D.size(); k++) ret.push_back(readMatrix(prefix, k));
+            return ret;
+        }
+        int conesBuilt() const{
+            return cones;
+        }
+        void forget(){
+            for (auto &[crossings, prefix] : known) removeSpilledMaps(prefix);
+            known.clear();
+        }
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef MIRROR_PD
+#define MIRROR_PD
+#include <vector>
+#include "differentialMaps.hpp"
+
+using namespace std;
+
+// the mirror image of a diagram turns every crossing by one place, so the
+// strand that went over goes under and the 0- and 1-resolutions trade places.
+// resolution r of the mirror is resolution ~r of D with the same circles, and
+// the mirror's complex is the dual of D's read backwards: degree k of the
+// mirror is degree n-k of D, with (+) and (-) swapped on every circle but the
+// marked one, and its d_k is the transpose of D's d_(n-k-1). the two differ
+// only by this permutation of the generators, so weights, homology and
+// distances all carry over, with cycles and cocycles trading places
+
+PD mirrorPD(PD D){
+    PD ret(D.size());
+    for (int i = 0; i < D.size(); i++){
+        for (int j = 0; j < 4; j++) ret.crossings[i][j] = D.crossings[i][(j + 1) % 4];
+    }
+    return ret;
+}
+
+vector<vector<ll>> mirrorGeneratorIndex(PD D, bool reducedHomology){
+    // index[k][g] is the position in degree n-k of the mirror of generator g of degree k of D
+    int n = D.size();
+    int marked = reducedHomology ? 1 : 0;
+    ll all = (1ll << n) - 1;
+    CircleTable table(D);
+    vector<int> circles(1ll << n);
+    int ids[64];
+    for (ll r = 0; r <= all; r++) circles[r] = resolutionCircles(table, r, ids);
+    vector<ll> start(1ll << n), mirrorStart(1ll << n); // first generator of every resolution of D, in D and in the mirror
+    vector<ll> count(n+1, 0), mirrorCount(n+1, 0);
+    for (ll r = 0; r <= all; r++){
+        start[r] = count[__builtin_popcountll(r)];
+        count[__builtin_popcountll(r)] += 1ll << (circles[r] - marked);
+        ll s = all ^ r; // resolution r of the mirror is resolution s of D
+        mirrorStart[s] = mirrorCount[__builtin_popcountll(r)];
+        mirrorCount[__builtin_popcountll(r)] += 1ll << (circles[s] - marked);
+    }
+    vector<vector<ll>> index(n+1);
+    for (int k = 0; k <= n; k++) index[k].resize(count[k]);
+    for (ll r = 0; r <= all; r++){
+        ll generators = 1ll << (circles[r] - marked);
+        vector<ll> &degree = index[__builtin_popcountll(r)];
+        for (ll subset = 0; subset < generators; subset++) degree[start[r] + subset] = mirrorStart[r] + (subset ^ (generators - 1));
+    }
+    return index;
+}
+
+vector<Matrix> mirrorDifferentialMaps(PD D, const vector<Matrix> &maps, bool reducedHomology){
+    // the maps getMaps would build for mirrorPD(D), from D's own
+    int n = D.size();
+    vector<vector<ll>> index = mirrorGeneratorIndex(D, reducedHomology);
+    vector<Matrix> ret;
+    for (int k = 0; k < n; k++){
+        const Matrix &d = maps[n-k-1]; // degree n-k-1 of D to n-k
+        Matrix mirrored(d.c, d.r);
+        for (ll j = 0; j < d.r; j++){
+            for (ll i = 0; i < d.c; i++) if (d.mat[j][i]) mirrored.mat[index[n-k][i]][index[n-k-1][j]] = 1;
+        }
+        ret.push_back(mirrored);
+    }
+    return ret;
+}
+
+#endif
@@ -1,68 +1,24 @@
 #include "differentialMaps.hpp"
+#include "diskMaps.hpp"
 #include "matrices.hpp"
+#include "binaryMaps.hpp"
+#include "textExport.hpp"
 #pragma GCC optimize("O2")
 
 using namespace std;
 using ld = long double;
 using ll = long long;
 
-void outputAsIntegers(vector<vector<vector<bool>>> &maps){
-    ll n = maps.size();
-    for (ll i = 0; i < n; i++){ // i = number of 1 resolutions
-        cout << maps[i].size() << endl;
-        for (ll columnVectorIndex = 0; (ull) columnVectorIndex < maps[i].size(); columnVectorIndex++){
-            ll val = 1;
-            ll ret = 0;
-            for (ll row = 0; (ull) row < maps[i][columnVectorIndex].size(); row++){
-                ret += val * maps[i][columnVectorIndex][row];
-                val <<= 1;
-            }
-            cout << ret << ' ';
-        }
-        cout << endl << endl;
-    }
-}
-
-void outputMatrix(vector<vector<vector<bool>>> &maps){ // outputs assuming vector of column vectors
-    ll n = maps.size();
-    for (ll i = 0; i < n; i++){ // i = number of 1 resolutions
-        for (ll columnIndex = 0; (ull)columnIndex < maps[i][0].size(); columnIndex++){
-            for (ll rowIndex = 0; (ull)rowIndex < maps[i].size(); rowIndex++){
-                cout << maps[i][rowIndex][columnIndex] << ' ';
-            }
-            cout << endl;
-        }
-        cout << endl;
-    }
-}
-
-void outputMatrixGapNotation(vector<vector<vector<bool>>> &maps){
-    ll n = maps.size();
-    // compare the output on line i+1 with line n+i to get a distance
-    
-    for (ll i = 0; i < n; i++){ // i = number of 1 resolutions
-        cout << '[';
-        for (ll columnIndex = 0; (ull)columnIndex < maps[i][0].size(); columnIndex++){
-            cout << '[';
-            for (ll rowIndex = 0; (ull)rowIndex < maps[i].size(); rowIndex++){
-                cout << maps[i][rowIndex][columnIndex];
-                if (rowIndex < maps[i].size()-1) cout << ',';
-            }
-            cout << "]";
-            if (columnIndex < maps[i][0].size() - 1) cout << ',';
-        }
-        cout << ']';
-        cout << endl;
-    }
-}
-
 signed main(){
 // takes in the number of crossings followed by all the crossings in
 // space separated planar diagram notation in input.txt, and outputs
 // all of the differential matrices in output.txt
 
     int matrixFormat = 0;
-    // 0 for 0 and 1 matrices, 1 for gap notation, 2 for integers
+    // 0 for 0 and 1 matrices, 1 for gap notation, 2 for integers,
+    // 3 for the binary format in binaryMaps.hpp, written to output.khm,
+    // 4 for sage, 5 for MatrixMarket, written to output.d<i>.mtx and
+    // output.d<i>.t.mtx for the transposes
 
     bool reducedHomology = 1;
     // if set to true, it will use reduced homology, with
@@ -74,8 +30,20 @@ signed main(){
     bool getMaxSize = 1;
     // if set true, gets the max matrix size
 
+    bool exportFromDisk = 0;
+    // if set true, the maps are spilled to disk with spillDifferentialMaps
+    // and exported one at a time, so only one map is ever held in memory
+    string spillPrefix = "maps";
+
+    bool bothComplexes = 0;
+    // if set true, the regular and reduced maps are built from one cube
+    // and written in the binary format to output.khm and output.reduced.khm
+    int markedStrand = 0;
+    // the strand with the marked point of the reduced maps of bothComplexes,
+    // 0 for the smallest label
+
     freopen("input.txt", "r", stdin);
-    if (!timeOutput) freopen("output.txt", "w", stdout);
+    if (!timeOutput && !bothComplexes && matrixFormat != 3 && matrixFormat != matrixMarketFormat) freopen("output.txt", "w", stdout);
 
     vector<vector<int>> input;
     int x;
@@ -92,15 +60,29 @@ signed main(){
     PD D = createPlanarDiagram(input);
     ll n = D.size();
     
-    vector<vector<vector<bool>>> maps;
-    if (reducedHomology) maps = reducedDifferentialMaps(D);
+    if (bothComplexes){
+        DifferentialMapPair both = regularAndReducedDifferentialMaps(D, markedStrand);
+        writeBinaryMaps("output.khm", both.regular, n, 0);
+        writeBinaryMaps("output.reduced.khm", both.reduced, n, 1);
+        return 0;
+    }
+
+    vector<Matrix> maps;
+    if (exportFromDisk) spillDifferentialMaps(D, reducedHomology, spillPrefix);
+    else if (reducedHomology) maps = reducedDifferentialMaps(D);
     else maps = regularDifferentialMaps(D);
 
+    Matrix current;
+    auto mapAt = [&](ll i) -> const Matrix& {
+        if (!exportFromDisk) return maps[i];
+        current = readMatrix(spillPrefix, i);
+        return current;
+    };
 
     if (getMaxSize){
         ll maxSize = 0;
-        for (ll i = 0; i < maps.size(); i++){
-            maxSize = max(maxSize, (ll)maps[i].size());
+        for (ll i = 0; i < n; i++){
+            maxSize = max(maxSize, exportFromDisk ? sparseMapInfo(spillPrefix, i).domain : (ll)maps[i].size());
         }
         cerr << maxSize << endl;
         return 0;
@@ -112,30 +94,50 @@ signed main(){
         return 0;
     }
     
-    if (matrixFormat == 0){
-        outputMatrix(maps);
-    }
-    else if (matrixFormat == 2){
-        cout << n << endl;
-        outputAsIntegers(maps);
-    }
-    else{
-        outputMatrixGapNotation(maps);
+    if (matrixFormat == 3){
+        if (exportFromDisk){
+            for (ll i = 0; i < n; i++) maps.push_back(readMatrix(spillPrefix, i));
+        }
+        writeBinaryMaps("output.khm", maps, n, reducedHomology);
+        return 0;
     }
 
-    for (ll i = 0; i < n; i++){
-        maps[i] = takeTranspose(maps[i]);
+    ExportFormat format = (ExportFormat)matrixFormat;
+    if (format == matrixMarketFormat){
+        for (ll i = 0; i < n; i++){
+            const Matrix &map = mapAt(i);
+            for (int transposed = 0; transposed < 2; transposed++){
+                string path = "output.d" + to_string(i) + (transposed ? ".t" : "") + ".mtx";
+                FILE *file = fopen(path.c_str(), "w");
+                if (!file){
+                    cerr << "Could not open " << path << " for writing." << endl;
+                    return 1;
+                }
+                { // the writer flushes as it goes out of scope, before the file is closed
+                    TextWriter out(file);
+                    exportMatrixMarket(out, DenseMapView(map, transposed));
+                }
+                fclose(file);
+            }
+        }
+        return 0;
     }
 
-    if (matrixFormat == 0){
-        cout << endl << "Transposes Below" << endl;
-        outputMatrix(maps);
+    // all the maps, then all their transposes
+    TextWriter out(stdout);
+    if (format == integerFormat){
+        out.putNumber(n);
+        out.putChar('\n');
     }
-    else if (matrixFormat == 2){
-        outputAsIntegers(maps);
-    }
-    else{
-        outputMatrixGapNotation(maps);
+    for (int transposed = 0; transposed < 2; transposed++){
+        if (transposed && format == plainFormat) out.putString("\nTransposes Below\n");
+        for (ll i = 0; i < n; i++){
+            if (!exportMap(out, DenseMapView(mapAt(i), transposed), format)){
+                out.flush();
+                cerr << "Map " << i << (transposed ? " transposed" : "") << " has 64 or more rows, use matrixFormat 3 instead." << endl;
+                return 1;
+            }
+        }
     }
     
     
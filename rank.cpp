@@ -3,6 +3,8 @@
 // consider this source https://codeforces.com/blog/entry/98376
 
 #include <bits/stdc++.h>
+#include "diskMaps.hpp"
+#include "binaryMaps.hpp"
  
 using namespace std;
 using ll = long long;
@@ -29,6 +31,34 @@ void insertVector(ll mask) {
 }
 
 int main() {
+	bool fromDisk = 0;
+	// if set true, streams every map written by spillDifferentialMaps under
+	// prefix instead of reading integers from stdin
+	string prefix = "maps";
+	bool fromBinary = 0;
+	// if set true, does the same for every map in a file written by
+	// writeBinaryMaps
+	string binaryFile = "output.khm";
+
+	if (fromBinary) {
+		BinaryMapsFile file(binaryFile);
+		for (int i = 0; i < file.size(); i++) {
+			ll domain = file.map(i).entry.domain;
+			ll rank = columnRank(file.map(i));
+			cout << "Degree " << i << " rank: " << rank << ", nullity: " << domain - rank << endl;
+		}
+		return 0;
+	}
+
+	if (fromDisk) {
+		for (int i = 0; i < spilledMapCount(prefix); i++) {
+			ll domain = sparseMapInfo(prefix, i).domain;
+			ll rank = streamedRank(prefix, i);
+			cout << "Degree " << i << " rank: " << rank << ", nullity: " << domain - rank << endl;
+		}
+		return 0;
+	}
+
 	ll n;
 	cin >> n;
 
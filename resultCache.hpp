@@ -0,0 +1,134 @@
+#ifndef RESULT_CACHE
+#define RESULT_CACHE
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <filesystem>
+#include <unordered_map>
+#include "canonicalPD.hpp"
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+using ll = long long;
+using ull = unsigned long long;
+
+// results kept on disk between runs, addressed by the content of what was
+// computed. a key names a complex: the kind of complex followed by its
+// canonical diagram (see canonicalPD.hpp), e.g.
+//     reduced 1 2 3 4 ...
+//     annular@0 1 2 3 4 ... ; 5 3 1 ; 2 5 ; ...
+// every key owns the files <hash>.txt, which starts with the full key so
+// that hash collisions are caught, and <hash>.khm for its maps in the format
+// of binaryMaps.hpp. files are written under a temporary name and renamed,
+// so concurrent workers and interrupted runs never leave half an entry.
+// results seen by one process are also kept in memory, and a cache with an
+// empty directory lives in memory only
+
+string complexKey(const CanonicalPD &canonical, const string &kind, const vector<vector<int>> &faces = {}){
+    // faces are relabelled along with the strands; the punctured face stays first
+    ostringstream key;
+    key << kind;
+    for (auto &crossing : canonical.D.crossings){
+        for (int x : crossing) key << ' ' << x;
+    }
+    for (auto &face : faces){
+        key << " ;";
+        for (int x : face){
+            auto it = canonical.label.find(x);
+            key << ' ' << (it == canonical.label.end() ? 0 : it->second);
+        }
+    }
+    return key.str();
+}
+
+class ResultCache{
+    private:
+        string directory;
+        mutable unordered_map<string, string> resident; // key -> payload, for this process
+        static ll processId(){
+#ifdef _WIN32
+            return _getpid();
+#else
+            return getpid();
+#endif
+        }
+        static string hashName(const string &key){
+            // FNV-1a of the key
+            ull hash = 1469598103934665603ull;
+            for (unsigned char c : key){
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            ostringstream ss;
+            ss << hex << hash;
+            return ss.str();
+        }
+    public:
+        ResultCache(const string &cacheDirectory) : directory(cacheDirectory){
+            if (!onDisk()) return;
+            error_code error;
+            filesystem::create_directories(directory, error);
+            if (error){
+                cerr << "Could not create the cache directory " << directory << "." << endl;
+                exit(1);
+            }
+        }
+        bool onDisk() const{
+            return !directory.empty();
+        }
+        string mapsFile(const string &key) const{
+            // where the maps of key are, or should go
+            return directory + "/" + hashName(key) + ".khm";
+        }
+        bool hasMaps(const string &key) const{
+            return onDisk() && filesystem::exists(mapsFile(key));
+        }
+        string temporaryFile(const string &path) const{
+            // a unique name next to path to write to before calling publish
+            static ll counter = 0;
+            return path + ".tmp" + to_string(processId()) + "-" + to_string(counter++);
+        }
+        void publish(const string &temporary, const string &path) const{
+            error_code error; // replaces path where plain rename would not
+            filesystem::rename(temporary, path, error);
+        }
+        bool load(const string &key, string &payload) const{
+            // false on a miss
+            auto it = resident.find(key);
+            if (it != resident.end()){
+                payload = it->second;
+                return 1;
+            }
+            if (!onDisk()) return 0;
+            ifstream in(directory + "/" + hashName(key) + ".txt", ios::binary);
+            if (!in) return 0;
+            string storedKey;
+            getline(in, storedKey);
+            if (storedKey != key) return 0; // a different key with the same hash
+            ostringstream rest;
+            rest << in.rdbuf();
+            payload = rest.str();
+            resident[key] = payload;
+            return 1;
+        }
+        void save(const string &key, const string &payload) const{
+            resident[key] = payload;
+            if (!onDisk()) return;
+            string path = directory + "/" + hashName(key) + ".txt";
+            string temporary = temporaryFile(path);
+            {
+                ofstream out(temporary, ios::binary);
+                out << key << '\n' << payload;
+            }
+            publish(temporary, path);
+        }
+};
+
+#endif
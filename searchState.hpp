@@ -0,0 +1,150 @@
+#ifndef SEARCH_STATE
+#define SEARCH_STATE
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+using namespace std;
+
+using ll = long long;
+using ull = unsigned long long;
+
+// checkpointing for long distance searches
+// every search is identified by a key (direction, degree, mode and a hash of
+// the maps involved), and its state is enough to pick the enumeration back up
+// at the subset it stopped at. the unfinished states live in one text file,
+// one line per key, which is rewritten as a whole on every checkpoint; a
+// search that finishes is dropped from it, since its result is no longer a
+// cursor (the result cache is what keeps finished results across runs)
+
+class SearchState{
+    public:
+        string key;
+        int weight = 1; // size of the subsets currently being enumerated
+        vector<ull> cursor; // words of the next subset to check, empty for the first subset of this weight
+        ll count = 0; // minimally weighted elements found so far at this weight
+        ll candidates = 0; // subsets checked so far over all runs
+        bool saved = 0; // whether checkpointFile holds this state
+};
+
+bool useCheckpoints = 1;
+string checkpointFile = "checkpoint.txt";
+const int checkpointInterval = 20; // seconds between checkpoints of a running search, below distance.cpp's timeLimit
+const int progressInterval = 10; // seconds between progress reports on stderr
+
+map<string, SearchState> searchStates;
+volatile sig_atomic_t interrupted = 0;
+volatile sig_atomic_t searching = 0; // set while a search loop is running and polling interrupted
+
+void handleInterrupt(int){
+    // outside of a search there is nothing to save, so fall back to the default behaviour
+    if (!searching){
+        signal(SIGINT, SIG_DFL);
+        raise(SIGINT);
+        return;
+    }
+    interrupted = 1;
+}
+
+void loadSearchStates(){
+    // reads every saved state from checkpointFile, if it exists
+    searchStates.clear();
+    ifstream in(checkpointFile);
+    string line;
+    while (getline(in, line)){
+        istringstream ss(line);
+        SearchState state;
+        ll words;
+        bool finished; // always 0 now, older files also kept finished searches
+        if (!(ss >> state.key >> state.weight >> state.count >> state.candidates >> finished >> words) || finished) continue;
+        state.cursor.resize(words);
+        for (ll i = 0; i < words; i++) ss >> state.cursor[i];
+        state.saved = 1;
+        searchStates[state.key] = state;
+    }
+}
+
+void saveSearchStates(){
+    // writes to a temporary file first so an interrupted write never loses the old checkpoint
+    if (!useCheckpoints) return;
+    string tmpFile = checkpointFile + ".tmp";
+    {
+        ofstream out(tmpFile);
+        for (auto &entry : searchStates){
+            SearchState &state = entry.second;
+            out << state.key << ' ' << state.weight << ' ' << state.count << ' ' << state.candidates << ' '
+            << 0 << ' ' << state.cursor.size();
+            for (ull x : state.cursor) out << ' ' << x;
+            out << '\n';
+            state.saved = 1;
+        }
+    }
+    rename(tmpFile.c_str(), checkpointFile.c_str());
+}
+
+void dropSearchState(const string &key){
+    // forgets a search that finished, or one that will not be resumed; the
+    // file is only rewritten if it had the state
+    auto it = searchStates.find(key);
+    if (it == searchStates.end()) return;
+    bool saved = it->second.saved;
+    searchStates.erase(it);
+    if (saved) saveSearchStates();
+}
+
+enum SearchEvent{keepGoing, saveNow, outOfTime, stopNow};
+
+class SearchProgress{
+    // periodic bookkeeping shared by the enumerations: the clock is only read
+    // every 1024 candidates, progress goes to stderr every progressInterval
+    // seconds, and the caller is told when to checkpoint or stop
+    private:
+        SearchState &state;
+        int timeLimit;
+        long double tic, lastCheckpoint, lastReport;
+        ll reportedCandidates, sinceClockCheck = 0;
+    public:
+        SearchProgress(SearchState &searchState, int limit) : state(searchState), timeLimit(limit){
+            tic = lastCheckpoint = lastReport = clock();
+            reportedCandidates = state.candidates;
+            searching = 1;
+        }
+        ~SearchProgress(){
+            searching = 0;
+        }
+        template<class Label> SearchEvent poll(const Label &label){
+            // label() describes the search in the progress line and is only
+            // called when one is printed, so the loops never format per candidate
+            state.candidates++;
+            if (++sinceClockCheck < 1024) return keepGoing;
+            sinceClockCheck = 0;
+            long double tac = clock();
+            if (interrupted) return stopNow;
+            if ((tac - tic) / CLOCKS_PER_SEC > timeLimit) return outOfTime;
+            if ((tac - lastReport) / CLOCKS_PER_SEC > progressInterval){
+                cerr << state.key << ": " << label() << ", "
+                << (ll)((state.candidates - reportedCandidates) / ((tac - lastReport) / CLOCKS_PER_SEC)) << " candidates/s" << endl;
+                lastReport = tac;
+                reportedCandidates = state.candidates;
+            }
+            if ((tac - lastCheckpoint) / CLOCKS_PER_SEC > checkpointInterval){
+                lastCheckpoint = tac;
+                return saveNow;
+            }
+            return keepGoing;
+        }
+};
+
+void startCheckpointing(){
+    // call once before the first search
+    if (!useCheckpoints) return;
+    loadSearchStates();
+    signal(SIGINT, handleInterrupt);
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef SIMPLIFY_PD
+#define SIMPLIFY_PD
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "differentialMaps.hpp"
+
+using namespace std;
+
+// Reidemeister I and II simplification of a planar diagram before its cube is
+// built. crossings are read as in KnotTheory, positions 0 and 2 on the under
+// strand and 1 and 3 on the over strand, with the 0-resolution pairing 0-1
+// and 2-3. the complexes of the diagram and of the simplified one are
+// homotopy equivalent up to a shift, so their homology agrees but the
+// complexes themselves (and anything like distances computed from them) do
+// not. with [[D]] the complex these builders make, every move gives
+//     R1, loop closed in the 0-resolution (positions 0-1 or 2-3):  [[D]] = [[D']]{-1}
+//     R1, loop closed in the 1-resolution (positions 1-2 or 3-0):  [[D]] = [[D']][1]{2}
+//     R2, one strand over the other at both crossings:            [[D]] = [[D']][1]{1}
+// where [s] moves homological degree r to r+s and {s} quantum degree by s.
+// moves that would leave a circle without crossings are not made, and the
+// strand with the smallest label (the marked strand of the reduced complex)
+// is followed through every move and labelled 1 at the end
+
+class SimplifiedPD{
+    public:
+        PD D;
+        int homologicalShift = 0; // degree r of D's complex is degree r + homologicalShift of the original
+        int quantumShift = 0;
+        int removedByR1 = 0, removedByR2 = 0; // crossings
+};
+
+SimplifiedPD simplifyPD(PD original){
+    vector<vector<int>> crossings = original.crossings;
+    SimplifiedPD ret;
+    if (crossings.empty()){
+        ret.D = original;
+        return ret;
+    }
+    int marked = crossings[0][0];
+    for (auto &c : crossings) for (int x : c) marked = min(marked, x);
+
+    auto occurrences = [&](int label, int skip1, int skip2){
+        // how often label appears outside the crossings skip1 and skip2
+        int count = 0;
+        for (int i = 0; i < (int)crossings.size(); i++){
+            if (i == skip1 || i == skip2) continue;
+            for (int x : crossings[i]) count += x == label;
+        }
+        return count;
+    };
+    auto relabel = [&](int from, int to){
+        for (auto &c : crossings) for (int &x : c) if (x == from) x = to;
+        if (marked == from) marked = to;
+    };
+    auto removeCrossings = [&](int i, int j){ // j may equal i
+        if (i < j) swap(i, j);
+        crossings.erase(crossings.begin() + i);
+        if (j != i) crossings.erase(crossings.begin() + j);
+    };
+
+    bool changed = 1;
+    while (changed){
+        changed = 0;
+        // R1: two neighbouring positions of one crossing on the same strand
+        for (int i = 0; i < (int)crossings.size() && !changed; i++){
+            const vector<int> &c = crossings[i];
+            for (int p = 0; p < 4; p++){
+                if (c[p] != c[(p+1) % 4]) continue;
+                int loop = c[p], a = c[(p+2) % 4], b = c[(p+3) % 4];
+                if (a == b || a == loop || occurrences(a, i, i) == 0) break; // nothing left to join
+                bool zeroResolution = p == 0 || p == 2;
+                crossings.erase(crossings.begin() + i);
+                relabel(loop, a);
+                relabel(b, a);
+                ret.homologicalShift += zeroResolution ? 0 : 1;
+                ret.quantumShift += zeroResolution ? -1 : 2;
+                ret.removedByR1++;
+                changed = 1;
+                break;
+            }
+        }
+        // R2: two crossings joined by an over edge at odd positions of both
+        // and an under edge at even positions of both
+        for (int i = 0; i < (int)crossings.size() && !changed; i++){
+            for (int j = i + 1; j < (int)crossings.size() && !changed; j++){
+                const vector<int> &A = crossings[i], &B = crossings[j];
+                for (int pa = 1; pa < 4 && !changed; pa += 2){
+                    int pb = find(B.begin(), B.end(), A[pa]) - B.begin();
+                    if (pb == 4 || pb % 2 == 0) continue;
+                    if (count(A.begin(), A.end(), A[pa]) != 1 || count(B.begin(), B.end(), A[pa]) != 1) continue;
+                    for (int qa = 0; qa < 4 && !changed; qa += 2){
+                        int qb = find(B.begin(), B.end(), A[qa]) - B.begin();
+                        if (qb == 4 || qb % 2 == 1) continue;
+                        if (count(A.begin(), A.end(), A[qa]) != 1 || count(B.begin(), B.end(), A[qa]) != 1) continue;
+                        // both pairs of positions have to be neighbours, so the two edges bound a bigon
+                        if ((pa + 1) % 4 != qa && (qa + 1) % 4 != pa) continue;
+                        if ((pb + 1) % 4 != qb && (qb + 1) % 4 != pb) continue;
+                        int over = A[pa], under = A[qa];
+                        int a = A[(pa + 2) % 4], b = B[(pb + 2) % 4]; // the over strand outside the bigon
+                        int c = A[(qa + 2) % 4], d = B[(qb + 2) % 4]; // the under strand outside the bigon
+                        if (a == b || c == d) continue; // the strand would close up into a free circle
+                        if (occurrences(a, i, j) + occurrences(b, i, j) == 0 || occurrences(c, i, j) + occurrences(d, i, j) == 0) continue;
+                        removeCrossings(i, j);
+                        relabel(over, a);
+                        relabel(b, a);
+                        relabel(under, c);
+                        relabel(d, c);
+                        ret.homologicalShift += 1;
+                        ret.quantumShift += 1;
+                        ret.removedByR2 += 2;
+                        changed = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    // renumber the strands 1, 2, ... in order of appearance, the marked one first
+    map<int, int> label;
+    label[marked] = 1;
+    for (auto &c : crossings){
+        for (int x : c){
+            if (!label.count(x)){
+                int next = label.size() + 1;
+                label[x] = next;
+            }
+        }
+    }
+    ret.D = PD(crossings.size());
+    for (int i = 0; i < (int)crossings.size(); i++){
+        for (int k = 0; k < 4; k++) ret.D.crossings[i][k] = label[crossings[i][k]];
+    }
+    return ret;
+}
+
+vector<ll> unshiftHomology(const vector<ll> &simplified, const SimplifiedPD &simplification, int originalCrossings){
+    // homology by degree of the simplified diagram, put back in the degrees of the original
+    vector<ll> ret(originalCrossings + 1, 0);
+    for (int r = 0; r < (int)simplified.size(); r++){
+        int degree = r + simplification.homologicalShift;
+        if (degree >= 0 && degree <= originalCrossings) ret[degree] = simplified[r];
+    }
+    return ret;
+}
+
+#endif
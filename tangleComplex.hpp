@@ -0,0 +1,479 @@
+#ifndef TANGLE_COMPLEX
+#define TANGLE_COMPLEX
+#include <vector>
+#include <map>
+#include <set>
+#include <climits>
+#include <cassert>
+#include <array>
+#include <algorithm>
+#include "differentialMaps.hpp"
+#include "crossingOrder.hpp"
+
+using namespace std;
+
+// Bar-Natan's divide and conquer algorithm over F2 ("Fast Khovanov homology
+// computations"). instead of the whole cube, a complex for the tangle made of
+// the crossings added so far is kept, and after every crossing its closed
+// circles are delooped and every isomorphism in the differential is cancelled
+// by Gaussian elimination, so the complex stays about as small as the homology
+// of the tangle. an object is a crossingless matching of the boundary points
+// of the tangle; a map between two matchings is a sum of cobordisms, each
+// reduced by the relations of F2[x]/(x^2) (neck cutting, handle = 0, two dots
+// = 0, sphere = 0, dotted sphere = 1) to a set of dotted disks, one disk per
+// cycle of the two matchings put together. so a cobordism is stored as a
+// bitmask of the cycles that carry a dot.
+// for reduced homology the marked strand is cut open into two boundary points
+// that are never glued, and a dot on the cycle through them is zero
+
+using Cobordism = vector<ull>; // a sum over F2 of dotted-disk terms, sorted
+
+void normalizeCobordism(Cobordism &f){
+    // sorts and drops the terms that appear an even number of times
+    sort(f.begin(), f.end());
+    int k = 0;
+    for (int i = 0; i < (int)f.size(); ){
+        int j = i;
+        while (j < (int)f.size() && f[j] == f[i]) j++;
+        if ((j - i) % 2) f[k++] = f[i];
+        i = j;
+    }
+    f.resize(k);
+}
+
+int matchingCycles(const vector<int> &A, const vector<int> &B, vector<int> &cycle){
+    // cycle[p] is the cycle of A and B put together through boundary point p,
+    // numbered in order of their smallest point. returns the number of cycles
+    int n = A.size(), count = 0;
+    cycle.assign(n, -1);
+    for (int p = 0; p < n; p++){
+        if (cycle[p] != -1) continue;
+        for (int x = p; cycle[x] == -1; x = B[A[x]]) cycle[x] = cycle[A[x]] = count;
+        count++;
+    }
+    return count;
+}
+
+class Surface{
+    // a cobordism put together from disks glued along intervals and circles,
+    // whose boundary is a set of cycles of the source and target matchings.
+    // evaluate reduces it, for a choice of dots on the disks, to dotted disks
+    // on those cycles
+    private:
+        vector<int> parent, euler;
+        vector<vector<int>> componentCycles; // boundary cycles of every component
+        vector<int> componentOf; // piece -> component
+        vector<bool> closedSphere;
+        int markedCycle = -1;
+        bool vanishes = 0; // some component has a handle
+        int root(int x){
+            while (parent[x] != x) x = parent[x] = parent[parent[x]];
+            return x;
+        }
+        void join(int a, int b){
+            a = root(a), b = root(b);
+            if (a == b) return;
+            parent[b] = a;
+            euler[a] += euler[b];
+        }
+    public:
+        int addPiece(){
+            parent.push_back(parent.size());
+            euler.push_back(1);
+            return parent.size() - 1;
+        }
+        void glueInterval(int a, int b){
+            join(a, b);
+            euler[root(a)]--;
+        }
+        void glueCircle(int a, int b){
+            join(a, b);
+        }
+        void close(const vector<int> &cyclePiece, int marked){
+            // cyclePiece[c] is a piece that boundary cycle c runs along
+            assert(cyclePiece.size() <= 64);
+            markedCycle = marked;
+            map<int, int> component;
+            componentOf.assign(parent.size(), 0);
+            for (int i = 0; i < (int)parent.size(); i++){
+                int r = root(i);
+                if (!component.count(r)){
+                    int next = component.size();
+                    component[r] = next;
+                }
+                componentOf[i] = component[r];
+            }
+            componentCycles.assign(component.size(), {});
+            for (int c = 0; c < (int)cyclePiece.size(); c++) componentCycles[componentOf[cyclePiece[c]]].push_back(c);
+            closedSphere.assign(component.size(), 0);
+            for (auto &[r, k] : component){
+                int cycles = componentCycles[k].size();
+                if (cycles == 0){
+                    if (euler[r] != 2) vanishes = 1;
+                    closedSphere[k] = 1;
+                }
+                else if (2 - euler[r] - cycles > 0) vanishes = 1;
+            }
+        }
+        void evaluate(const vector<int> &pieceDots, Cobordism &result){
+            // appends the dotted-disk terms of the surface with these dots
+            if (vanishes) return;
+            vector<int> dots(componentCycles.size(), 0);
+            for (int i = 0; i < (int)pieceDots.size(); i++) dots[componentOf[i]] += pieceDots[i];
+            ull base = 0;
+            vector<int> choices; // undotted components, cut into disks by neck cutting
+            for (int k = 0; k < (int)componentCycles.size(); k++){
+                if (closedSphere[k]){
+                    if (dots[k] != 1) return;
+                    continue;
+                }
+                if (dots[k] >= 2) return;
+                bool marked = find(componentCycles[k].begin(), componentCycles[k].end(), markedCycle) != componentCycles[k].end();
+                ull all = 0;
+                for (int c : componentCycles[k]) all |= 1ull << c;
+                if (dots[k] == 1){
+                    if (marked) return;
+                    base |= all;
+                }
+                else if (marked) base |= all & ~(1ull << markedCycle);
+                else choices.push_back(k);
+            }
+            // a tube is dot on one end plus dot on the other, so an undotted
+            // component with k cycles is the sum of the k ways to leave one undotted
+            size_t first = result.size();
+            result.push_back(base);
+            for (int k : choices){
+                ull all = 0;
+                for (int c : componentCycles[k]) all |= 1ull << c;
+                size_t last = result.size();
+                for (size_t t = first; t < last; t++){
+                    ull term = result[t];
+                    result[t] = term | (all & ~(1ull << componentCycles[k][0]));
+                    for (int i = 1; i < (int)componentCycles[k].size(); i++) result.push_back(term | (all & ~(1ull << componentCycles[k][i])));
+                }
+            }
+        }
+};
+
+class TangleObject{
+    public:
+        vector<int> partner; // partner[p] is the boundary point matched with p
+        int degree = 0; // number of 1-resolutions, as in the cube
+        int q = 0; // quantum shift
+        bool alive = 1;
+};
+
+class TangleComplex{
+    private:
+        int markedLabel = INT_MIN; // the cut strand of the reduced complex
+
+        int markedPosition(){
+            int p = find(boundary.begin(), boundary.end(), markedLabel) - boundary.begin();
+            return p == (int)boundary.size() ? -1 : p;
+        }
+        Cobordism compose(const vector<int> &A, const vector<int> &B, const vector<int> &C, const Cobordism &f, const Cobordism &g){
+            // g after f, for f from A to B and g from B to C
+            vector<int> cycleAB, cycleBC, cycleAC;
+            int ab = matchingCycles(A, B, cycleAB), bc = matchingCycles(B, C, cycleBC), ac = matchingCycles(A, C, cycleAC);
+            Surface surface;
+            for (int i = 0; i < ab + bc; i++) surface.addPiece();
+            for (int p = 0; p < (int)B.size(); p++){
+                if (p < B[p]) surface.glueInterval(cycleAB[p], ab + cycleBC[p]);
+            }
+            vector<int> cyclePiece(ac);
+            for (int p = 0; p < (int)A.size(); p++) cyclePiece[cycleAC[p]] = cycleAB[p];
+            int marked = markedPosition();
+            surface.close(cyclePiece, marked == -1 ? -1 : cycleAC[marked]);
+            Cobordism ret;
+            vector<int> dots(ab + bc);
+            for (ull x : f){
+                for (ull y : g){
+                    for (int i = 0; i < ab; i++) dots[i] = x >> i & 1;
+                    for (int i = 0; i < bc; i++) dots[ab + i] = y >> i & 1;
+                    surface.evaluate(dots, ret);
+                }
+            }
+            normalizeCobordism(ret);
+            return ret;
+        }
+        void setEntry(int i, int j, Cobordism f){
+            // adds f to the part of the differential from i to j
+            Cobordism &entry = out[i][j];
+            entry.insert(entry.end(), f.begin(), f.end());
+            normalizeCobordism(entry);
+            if (entry.empty()){
+                out[i].erase(j);
+                in[j].erase(i);
+            }
+            else in[j].insert(i);
+        }
+        void cancel(int i, int j){
+            // Gaussian elimination of the isomorphism from i to j
+            vector<pair<int, Cobordism>> into, from;
+            for (int c : in[j]) if (c != i) into.push_back({c, out[c][j]});
+            for (auto &[e, g] : out[i]) if (e != j) from.push_back({e, g});
+            for (auto &[c, f] : into){
+                for (auto &[e, g] : from){
+                    Cobordism h = compose(objects[c].partner, objects[j].partner, objects[e].partner, f, g);
+                    if (!h.empty()) setEntry(c, e, h);
+                }
+            }
+            for (int x : {i, j}){
+                for (int c : in[x]) out[c].erase(x);
+                for (auto &[e, g] : out[x]) in[e].erase(x);
+                in[x].clear();
+                out[x].clear();
+                objects[x].alive = 0;
+            }
+        }
+    public:
+        vector<int> boundary; // strand label of every boundary point
+        vector<TangleObject> objects; // with the ones cancelled marked dead
+        vector<map<int, Cobordism>> out; // out[i][j] is the part of the differential from i to j
+        vector<set<int>> in;
+
+        TangleComplex(int marked = INT_MIN) : markedLabel(marked){
+            // the empty tangle
+            objects.resize(1);
+            out.resize(1);
+            in.resize(1);
+        }
+        void addCrossing(const vector<int> &x){
+            // tensors with the complex 0-resolution -> 1-resolution of a crossing
+            int b = boundary.size();
+            vector<int> slotOf(b, -1), pointOf(4, -1), kink(4, -1);
+            for (int k = 0; k < 4; k++){
+                for (int p = 0; p < b; p++) if (boundary[p] == x[k]) slotOf[p] = k, pointOf[k] = p;
+                for (int l = 0; l < 4; l++) if (l != k && x[l] == x[k]) kink[k] = l;
+            }
+            // the new boundary and where its points come from: old points, then crossing slots
+            vector<int> newBoundary, newPoint(b + 4, -1), origin;
+            for (int p = 0; p < b; p++){
+                if (slotOf[p] == -1){
+                    newPoint[p] = newBoundary.size();
+                    newBoundary.push_back(boundary[p]);
+                    origin.push_back(p);
+                }
+            }
+            for (int k = 0; k < 4; k++){
+                if (pointOf[k] == -1 && kink[k] == -1){
+                    newPoint[b + k] = newBoundary.size();
+                    newBoundary.push_back(x[k]);
+                    origin.push_back(b + k);
+                }
+            }
+            auto arcOf = [](int resolution, int k){ // the arc of a resolution through slot k
+                return resolution == 0 ? k / 2 : (k == 1 || k == 2);
+            };
+            auto slotPartner = [](int resolution, int k){
+                return resolution == 0 ? k ^ 1 : 3 - k;
+            };
+
+            class Glued{
+                public:
+                    vector<int> partner; // the matching on the new boundary
+                    vector<int> loopSlots; // a slot on every closed circle
+                    int first = 0; // index of the first of its 2^loops delooped objects
+            };
+            auto glue = [&](const vector<int> &M, int resolution){
+                // M with a resolution of the crossing attached, walked as a graph
+                // on the old points 0..b-1 and the slots b..b+3. every node has
+                // one or two edges, and the ends of the paths are the new boundary
+                vector<array<int, 2>> edges;
+                for (int p = 0; p < b; p++){
+                    if (p < M[p]) edges.push_back({p, M[p]});
+                    if (slotOf[p] != -1) edges.push_back({p, b + slotOf[p]});
+                }
+                for (int k = 0; k < 4; k++){
+                    if (k < slotPartner(resolution, k)) edges.push_back({b + k, b + slotPartner(resolution, k)});
+                    if (k < kink[k]) edges.push_back({b + k, b + kink[k]});
+                }
+                vector<vector<int>> incident(b + 4);
+                for (int e = 0; e < (int)edges.size(); e++){
+                    incident[edges[e][0]].push_back(e);
+                    incident[edges[e][1]].push_back(e);
+                }
+                vector<bool> seen(b + 4, 0);
+                auto walk = [&](int at){ // the other end of the path from at, or at itself round a cycle
+                    int via = -1;
+                    seen[at] = 1;
+                    while (1){
+                        int e = -1;
+                        for (int f : incident[at]) if (f != via) e = f;
+                        if (e == -1) return at;
+                        int step = edges[e][0] == at ? edges[e][1] : edges[e][0];
+                        if (seen[step]) return at;
+                        seen[step] = 1;
+                        at = step, via = e;
+                    }
+                };
+                Glued ret;
+                ret.partner.assign(newBoundary.size(), -1);
+                for (int v = 0; v < b + 4; v++){
+                    if (seen[v] || incident[v].size() != 1) continue;
+                    int end = walk(v);
+                    ret.partner[newPoint[v]] = newPoint[end];
+                    ret.partner[newPoint[end]] = newPoint[v];
+                }
+                for (int k = 0; k < 4; k++){
+                    if (seen[b + k]) continue;
+                    walk(b + k);
+                    ret.loopSlots.push_back(k);
+                }
+                return ret;
+            };
+
+            // the delooped objects: a loop is the sum of the tangle without it
+            // shifted up by one (the loop labelled 1, bit 0) and down by one
+            // (labelled x, bit 1)
+            vector<array<Glued, 2>> glued(objects.size());
+            vector<TangleObject> newObjects;
+            for (int i = 0; i < (int)objects.size(); i++){
+                if (!objects[i].alive) continue;
+                for (int resolution = 0; resolution < 2; resolution++){
+                    Glued &g = glued[i][resolution];
+                    g = glue(objects[i].partner, resolution);
+                    g.first = newObjects.size();
+                    int loops = g.loopSlots.size();
+                    for (int labels = 0; labels < (1 << loops); labels++){
+                        TangleObject o;
+                        o.partner = g.partner;
+                        o.degree = objects[i].degree + resolution;
+                        o.q = objects[i].q + resolution + loops - 2 * __builtin_popcount(labels);
+                        newObjects.push_back(o);
+                    }
+                }
+            }
+            int newMarked = find(newBoundary.begin(), newBoundary.end(), markedLabel) - newBoundary.begin();
+            vector<map<int, Cobordism>> newOut(newObjects.size());
+            vector<set<int>> newIn(newObjects.size());
+
+            auto glueMap = [&](int i, int j, const Cobordism &f, int from, int to){
+                // f from object i to object j, next to the identity of a
+                // resolution of the crossing (from == to) or its saddle
+                const vector<int> &M = objects[i].partner, &N = objects[j].partner;
+                const Glued &source = glued[i][from], &target = glued[j][to];
+                vector<int> cycleMN;
+                int mn = matchingCycles(M, N, cycleMN);
+                Surface surface;
+                for (int c = 0; c < mn; c++) surface.addPiece();
+                int firstSlotPiece = surface.addPiece(); // a square per arc, or one saddle
+                if (from == to) surface.addPiece();
+                vector<int> slotPiece(4);
+                for (int k = 0; k < 4; k++) slotPiece[k] = firstSlotPiece + (from == to ? arcOf(from, k) : 0);
+                for (int p = 0; p < b; p++) if (slotOf[p] != -1) surface.glueInterval(cycleMN[p], slotPiece[slotOf[p]]);
+                for (int k = 0; k < 4; k++) if (k < kink[k]) surface.glueInterval(slotPiece[k], slotPiece[kink[k]]);
+                // a cup on every loop of the source and a cap on every loop of the target
+                int sourceLoops = source.loopSlots.size(), targetLoops = target.loopSlots.size();
+                int firstCup = mn + (from == to ? 2 : 1);
+                for (int slot : source.loopSlots) surface.glueCircle(surface.addPiece(), slotPiece[slot]);
+                for (int slot : target.loopSlots) surface.glueCircle(surface.addPiece(), slotPiece[slot]);
+                vector<int> cycle;
+                int cycles = matchingCycles(source.partner, target.partner, cycle);
+                vector<int> cyclePiece(cycles);
+                for (int p = 0; p < (int)newBoundary.size(); p++){
+                    cyclePiece[cycle[p]] = origin[p] < b ? cycleMN[origin[p]] : slotPiece[origin[p] - b];
+                }
+                surface.close(cyclePiece, newMarked == (int)newBoundary.size() ? -1 : cycle[newMarked]);
+                // the part from a labelling of the source loops to one of the
+                // target loops: a cup is dotted when its loop is labelled x, and
+                // a cap (the coefficient of its label) when it is labelled 1
+                vector<int> dots(firstCup + sourceLoops + targetLoops, 0);
+                for (int sourceLabels = 0; sourceLabels < (1 << sourceLoops); sourceLabels++){
+                    for (int targetLabels = 0; targetLabels < (1 << targetLoops); targetLabels++){
+                        Cobordism g;
+                        for (int l = 0; l < sourceLoops; l++) dots[firstCup + l] = sourceLabels >> l & 1;
+                        for (int l = 0; l < targetLoops; l++) dots[firstCup + sourceLoops + l] = !(targetLabels >> l & 1);
+                        for (ull term : f){
+                            for (int c = 0; c < mn; c++) dots[c] = term >> c & 1;
+                            surface.evaluate(dots, g);
+                        }
+                        normalizeCobordism(g);
+                        if (g.empty()) continue;
+                        int s = source.first + sourceLabels, t = target.first + targetLabels;
+                        Cobordism &entry = newOut[s][t];
+                        entry.insert(entry.end(), g.begin(), g.end());
+                        normalizeCobordism(entry);
+                        if (entry.empty()) newOut[s].erase(t);
+                    }
+                }
+            };
+            for (int i = 0; i < (int)objects.size(); i++){
+                if (!objects[i].alive) continue;
+                glueMap(i, i, {0}, 0, 1); // the saddle, next to the identity of the tangle
+                for (auto &[j, f] : out[i]){
+                    for (int resolution = 0; resolution < 2; resolution++) glueMap(i, j, f, resolution, resolution);
+                }
+            }
+            for (int s = 0; s < (int)newOut.size(); s++){
+                for (auto &[t, f] : newOut[s]) newIn[t].insert(s);
+            }
+
+            boundary = newBoundary;
+            objects = newObjects;
+            out = newOut;
+            in = newIn;
+            simplify();
+        }
+        bool isIsomorphism(int i, int j){
+            // an identity between two objects with the same matching
+            auto it = out[i].find(j);
+            return it != out[i].end() && it->second.size() == 1 && it->second[0] == 0 && objects[i].partner == objects[j].partner;
+        }
+        void simplify(){
+            // cancels isomorphisms until none are left, cheapest first: a
+            // cancellation adds up to (maps into j) * (maps out of i) entries,
+            // so taking those with few neighbours first keeps the complex sparse
+            while (1){
+                vector<pair<ll, pair<int, int>>> candidates;
+                for (int i = 0; i < (int)objects.size(); i++){
+                    if (!objects[i].alive) continue;
+                    for (auto &[j, f] : out[i]){
+                        if (isIsomorphism(i, j)) candidates.push_back({(ll)(in[j].size() - 1) * (ll)(out[i].size() - 1), {i, j}});
+                    }
+                }
+                if (candidates.empty()) break;
+                sort(candidates.begin(), candidates.end());
+                for (auto &[cost, pair] : candidates){
+                    auto [i, j] = pair;
+                    if (objects[i].alive && objects[j].alive && isIsomorphism(i, j)) cancel(i, j);
+                }
+            }
+        }
+        vector<map<int, ll>> homology(){
+            // dimensions by degree and quantum shift, once the tangle is closed
+            // (or only the cut marked strand is left) and the differential vanishes
+            vector<map<int, ll>> ret;
+            for (int i = 0; i < (int)objects.size(); i++){
+                if (!objects[i].alive) continue;
+                assert(out[i].empty());
+                if ((int)ret.size() <= objects[i].degree) ret.resize(objects[i].degree + 1);
+                ret[objects[i].degree][objects[i].q]++;
+            }
+            return ret;
+        }
+};
+
+vector<map<int, ll>> tangleHomology(PD D, bool reducedHomology){
+    // homology over F2 by degree and quantum shift, as the cube would give
+    // it; reduced homology takes the marked point on the smallest strand.
+    // crossings are added in minimumWidthOrder
+    vector<vector<int>> crossings = permuteCrossings(D, minimumWidthOrder(D)).crossings;
+    int marked = INT_MIN;
+    if (reducedHomology && !crossings.empty()){
+        marked = INT_MAX;
+        int largest = INT_MIN;
+        for (auto &c : crossings) for (int x : c) marked = min(marked, x), largest = max(largest, x);
+        // cut the marked strand: its last end gets a label of its own
+        for (int i = crossings.size() - 1, done = 0; i >= 0 && !done; i--){
+            for (int k = 3; k >= 0 && !done; k--){
+                if (crossings[i][k] == marked) crossings[i][k] = largest + 1, done = 1;
+            }
+        }
+    }
+    TangleComplex complex(marked);
+    for (auto &c : crossings) complex.addCrossing(c);
+    return complex.homology();
+}
+
+#endif
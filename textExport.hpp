@@ -0,0 +1,177 @@
+#ifndef TEXT_EXPORT
+#define TEXT_EXPORT
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "matrices.hpp"
+
+using namespace std;
+
+using ll = long long;
+using ull = unsigned long long;
+
+// text exporters for differential maps. a map is read through a view with
+// rows(), columns() and entry(row, column) in the usual matrix sense, so d_i
+// has a row per generator of degree i+1 and a column per generator of degree
+// i. a view can also present the transpose, so no transposed copy is ever
+// built, and everything is formatted into one buffer that is written out in
+// large chunks
+
+enum ExportFormat{ // numbered as matrixFormat in outputDifferentialMaps
+    plainFormat = 0, // rows of space separated 0s and 1s, a blank line after each map
+    gapFormat = 1, // one nested list of rows per line
+    integerFormat = 2, // the number of columns, then every column packed into an integer
+    sageFormat = 4, // one matrix(GF(2), ...) per line
+    matrixMarketFormat = 5 // coordinate format, one map per file
+};
+
+class TextWriter{
+    private:
+        FILE *file;
+        vector<char> buffer;
+        size_t used = 0;
+    public:
+        TextWriter(FILE *out, size_t bufferSize = 1 << 16) : file(out), buffer(bufferSize) {}
+        TextWriter(const TextWriter&) = delete;
+        TextWriter& operator=(const TextWriter&) = delete;
+        ~TextWriter(){
+            flush();
+        }
+        void putChar(char c){
+            if (used == buffer.size()) flush();
+            buffer[used++] = c;
+        }
+        void putString(const char *s){
+            while (*s) putChar(*s++);
+        }
+        void putNumber(ll x){
+            if (x < 0){
+                putChar('-');
+                x = -x;
+            }
+            char digits[20];
+            int k = 0;
+            do digits[k++] = '0' + x % 10; while (x /= 10);
+            while (k) putChar(digits[--k]);
+        }
+        void flush(){
+            fwrite(buffer.data(), 1, used, file);
+            used = 0;
+            fflush(file);
+        }
+};
+
+class DenseMapView{
+    // a Matrix from the builders (a vector of column vectors), or its transpose
+    private:
+        const Matrix &map;
+        bool transposed;
+    public:
+        DenseMapView(const Matrix &m, bool transpose = 0) : map(m), transposed(transpose) {}
+        ll rows() const{
+            return transposed ? map.r : map.c;
+        }
+        ll columns() const{
+            return transposed ? map.c : map.r;
+        }
+        bool entry(ll row, ll column) const{
+            return transposed ? map.mat[row][column] : map.mat[column][row];
+        }
+};
+
+template<class View> void exportPlain(TextWriter &out, const View &map){
+    for (ll row = 0; row < map.rows(); row++){
+        for (ll column = 0; column < map.columns(); column++){
+            out.putChar('0' + map.entry(row, column));
+            out.putChar(' ');
+        }
+        out.putChar('\n');
+    }
+    out.putChar('\n');
+}
+
+template<class View> void exportGap(TextWriter &out, const View &map){
+    out.putChar('[');
+    for (ll row = 0; row < map.rows(); row++){
+        out.putChar('[');
+        for (ll column = 0; column < map.columns(); column++){
+            out.putChar('0' + map.entry(row, column));
+            if (column < map.columns() - 1) out.putChar(',');
+        }
+        out.putChar(']');
+        if (row < map.rows() - 1) out.putChar(',');
+    }
+    out.putString("]\n");
+}
+
+template<class View> void exportSage(TextWriter &out, const View &map){
+    out.putString("matrix(GF(2), ");
+    out.putNumber(map.rows());
+    out.putString(", ");
+    out.putNumber(map.columns());
+    out.putString(", [");
+    for (ll row = 0; row < map.rows(); row++){
+        out.putChar('[');
+        for (ll column = 0; column < map.columns(); column++){
+            out.putChar('0' + map.entry(row, column));
+            if (column < map.columns() - 1) out.putChar(',');
+        }
+        out.putChar(']');
+        if (row < map.rows() - 1) out.putChar(',');
+    }
+    out.putString("])\n");
+}
+
+template<class View> bool exportIntegers(TextWriter &out, const View &map){
+    // bit k of a column's integer is its entry in row k, so this needs fewer
+    // than 64 rows; returns false without writing anything otherwise
+    if (map.rows() >= 64) return 0;
+    out.putNumber(map.columns());
+    out.putChar('\n');
+    for (ll column = 0; column < map.columns(); column++){
+        ull packed = 0;
+        for (ll row = 0; row < map.rows(); row++){
+            if (map.entry(row, column)) packed |= 1ull << row;
+        }
+        out.putNumber(packed);
+        out.putChar(' ');
+    }
+    out.putString("\n\n");
+    return 1;
+}
+
+template<class View> void exportMatrixMarket(TextWriter &out, const View &map){
+    // one complete MatrixMarket file, entries in column-major order and 1-indexed
+    ll entries = 0;
+    for (ll column = 0; column < map.columns(); column++){
+        for (ll row = 0; row < map.rows(); row++) entries += map.entry(row, column);
+    }
+    out.putString("%%MatrixMarket matrix coordinate integer general\n");
+    out.putNumber(map.rows());
+    out.putChar(' ');
+    out.putNumber(map.columns());
+    out.putChar(' ');
+    out.putNumber(entries);
+    out.putChar('\n');
+    for (ll column = 0; column < map.columns(); column++){
+        for (ll row = 0; row < map.rows(); row++){
+            if (!map.entry(row, column)) continue;
+            out.putNumber(row + 1);
+            out.putChar(' ');
+            out.putNumber(column + 1);
+            out.putString(" 1\n");
+        }
+    }
+}
+
+template<class View> bool exportMap(TextWriter &out, const View &map, ExportFormat format){
+    // false when the map cannot be written in this format
+    if (format == plainFormat) exportPlain(out, map);
+    else if (format == gapFormat) exportGap(out, map);
+    else if (format == sageFormat) exportSage(out, map);
+    else if (format == integerFormat) return exportIntegers(out, map);
+    else exportMatrixMarket(out, map);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef WEIGHT_ENUMERATOR
+#define WEIGHT_ENUMERATOR
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+using namespace std;
+
+using ll = long long;
+using ull = unsigned long long;
+
+// full weight distributions of binary linear codes
+// whichever of the code and its dual has the smaller dimension is enumerated
+// with a Gray-code walk split across threads, and the MacWilliams identity
+// converts a dual distribution into the distribution of the code itself
+
+const int maxEnumerationDimension = 40; // neither side is enumerated beyond 2^40 codewords
+
+int wideLimbs(int n){
+    // enough limbs for every intermediate MacWilliams sum over length n codes
+    return (n + maxEnumerationDimension + 64) / 64 + 2;
+}
+
+class WideInt{
+    // fixed-width two's complement integer, wide enough for the MacWilliams sums
+    public:
+        vector<ull> limbs;
+        WideInt(int numLimbs = 1, ull value = 0) : limbs(numLimbs, 0){
+            limbs[0] = value;
+        }
+        WideInt& operator+=(const WideInt &o){
+            unsigned __int128 carry = 0;
+            for (int i = 0; i < (int)limbs.size(); i++){
+                carry += (unsigned __int128)limbs[i] + o.limbs[i];
+                limbs[i] = (ull)carry;
+                carry >>= 64;
+            }
+            return *this;
+        }
+        WideInt& operator-=(const WideInt &o){
+            ull borrow = 0;
+            for (int i = 0; i < (int)limbs.size(); i++){
+                unsigned __int128 sub = (unsigned __int128)o.limbs[i] + borrow;
+                borrow = (unsigned __int128)limbs[i] < sub;
+                limbs[i] = (ull)((unsigned __int128)limbs[i] - sub);
+            }
+            return *this;
+        }
+        void addProduct(const WideInt &a, ull b){ // this += a * b
+            unsigned __int128 carry = 0;
+            for (int i = 0; i < (int)limbs.size(); i++){
+                carry += (unsigned __int128)a.limbs[i] * b + limbs[i];
+                limbs[i] = (ull)carry;
+                carry >>= 64;
+            }
+        }
+        void shiftRight(int bits){ // exact division by 2^bits of a non-negative value
+            int words = bits / 64, rest = bits % 64, n = limbs.size();
+            for (int i = 0; i < n; i++){
+                ull low = i + words < n ? limbs[i + words] : 0;
+                ull high = i + words + 1 < n ? limbs[i + words + 1] : 0;
+                limbs[i] = rest ? ((low >> rest) | (high << (64 - rest))) : low;
+            }
+        }
+        bool negative() const{
+            return limbs.back() >> 63;
+        }
+        string toString() const{
+            WideInt value = *this;
+            bool isNegative = value.negative();
+            if (isNegative){
+                WideInt zero(limbs.size());
+                zero -= value;
+                value = zero;
+            }
+            string ret;
+            bool nonzero = 1;
+            while (nonzero){
+                unsigned __int128 rem = 0;
+                nonzero = 0;
+                for (int i = (int)value.limbs.size() - 1; i >= 0; i--){
+                    unsigned __int128 cur = (rem << 64) | value.limbs[i];
+                    value.limbs[i] = (ull)(cur / 1000000000);
+                    rem = cur % 1000000000;
+                    if (value.limbs[i]) nonzero = 1;
+                }
+                string chunk = to_string((ull)rem);
+                if (nonzero) chunk = string(9 - chunk.size(), '0') + chunk;
+                ret = chunk + ret;
+            }
+            return (isNegative ? "-" : "") + ret;
+        }
+};
+
+template<class num> vector<ull> enumerateWeights(const vector<num> &generators, int n){
+    // distribution[w] = number of codewords of weight w in the span of the
+    // (independent) generators, every codeword counted once
+    int k = generators.size();
+    ull total = 1ull << k;
+    int threads = max(1u, thread::hardware_concurrency());
+    if ((ull)threads > total) threads = total;
+    vector<vector<ull>> partial(threads, vector<ull>(n + 1, 0));
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++){
+        workers.emplace_back([&, t](){
+            ull chunk = total / threads;
+            ull lo = chunk * t, hi = (t == threads - 1) ? total : chunk * (t + 1);
+            ull gray = lo ^ (lo >> 1);
+            num word;
+            for (int i = 0; i < k; i++) if (gray >> i & 1) word ^= generators[i];
+            for (ull g = lo; g < hi; g++){
+                if (g != lo) word ^= generators[__builtin_ctzll(g)];
+                partial[t][word.count()]++;
+            }
+        });
+    }
+    for (auto &worker : workers) worker.join();
+    vector<ull> distribution(n + 1, 0);
+    for (auto &p : partial){
+        for (int w = 0; w <= n; w++) distribution[w] += p[w];
+    }
+    return distribution;
+}
+
+vector<WideInt> macWilliams(const vector<ull> &dualDistribution, int n, int dualDimension){
+    // A_j = 2^-dualDimension * sum_i B_i K_j(i), where K_j(i) is the
+    // coefficient of x^j in P_i(x) = (1-x)^i (1+x)^(n-i); each P_(i+1) comes
+    // from P_i by dividing by (1+x) and multiplying by (1-x)
+    int numLimbs = wideLimbs(n);
+    vector<WideInt> poly(n + 1, WideInt(numLimbs)), sum(n + 1, WideInt(numLimbs));
+    poly[0] = WideInt(numLimbs, 1);
+    for (int i = 1; i <= n; i++){ // (1+x)^n
+        for (int j = i; j > 0; j--) poly[j] += poly[j-1];
+    }
+    for (int i = 0; i <= n; i++){
+        if (dualDistribution[i]){
+            for (int j = 0; j <= n; j++) sum[j].addProduct(poly[j], dualDistribution[i]);
+        }
+        if (i == n) break;
+        for (int j = 1; j <= n; j++) poly[j] -= poly[j-1]; // divide by (1+x), exact
+        for (int j = n; j > 0; j--) poly[j] -= poly[j-1]; // multiply by (1-x)
+    }
+    for (auto &x : sum) x.shiftRight(dualDimension);
+    return sum;
+}
+
+template<class num> vector<WideInt> codeWeightDistribution(const vector<num> &generators, const vector<num> &dualGenerators, int n){
+    // both generator lists should be independent; returns an empty vector
+    // when both sides are too large to enumerate
+    int numLimbs = wideLimbs(n);
+    if (generators.size() <= dualGenerators.size()){
+        if ((int)generators.size() > maxEnumerationDimension) return {};
+        vector<ull> distribution = enumerateWeights(generators, n);
+        vector<WideInt> ret;
+        for (ull x : distribution) ret.push_back(WideInt(numLimbs, x));
+        return ret;
+    }
+    if ((int)dualGenerators.size() > maxEnumerationDimension) return {};
+    return macWilliams(enumerateWeights(dualGenerators, n), n, dualGenerators.size());
+}
+
+#endif